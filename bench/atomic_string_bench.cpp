@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+// Readers take snapshots of a shared configuration string while one writer
+// keeps publishing new versions. Compares cow::atomic_string against a
+// cow::string guarded by a std::mutex, for 1 to 64 reader threads.
+
+#include <cow_atomic_string.hpp>
+#include "bench.hpp"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+static const long kLoadsPerThread = 200000;
+
+struct mutex_string {
+  cow::string load() {
+    std::lock_guard<std::mutex> lock( mutex );
+    return value;
+  }
+  void store( const cow::string& str ) {
+    std::lock_guard<std::mutex> lock( mutex );
+    value = str;
+  }
+  std::mutex  mutex;
+  cow::string value;
+};
+
+// Returns the average time of a load, in nanoseconds.
+template <class Holder>
+static double run( Holder& holder, int readers )
+{
+  const cow::string versions[2] = {
+    cow::string( 4096, 'a' ),
+    cow::string( 4096, 'b' ),
+  };
+  std::atomic<bool> done( false );
+  std::thread writer( [&] {
+    for( long i = 0; !done.load( std::memory_order_relaxed ); ++i ) {
+      holder.store( versions[i & 1] );
+      std::this_thread::yield();
+    }
+  });
+
+  const bench_clock::time_point start = bench_clock::now();
+  std::vector<std::thread> threads;
+  for( int t = 0; t < readers; ++t ) {
+    threads.emplace_back( [&] {
+      for( long i = 0; i < kLoadsPerThread; ++i ) {
+        cow::string snapshot = holder.load();
+        do_not_optimize( snapshot.data()[0] );
+      }
+    });
+  }
+  for( std::thread& t : threads ) {
+    t.join();
+  }
+  const double elapsed = seconds_since( start );
+  done = true;
+  writer.join();
+  return elapsed * 1e9 / kLoadsPerThread;
+}
+
+int main()
+{
+  std::printf( "%8s %20s %20s\n", "readers", "atomic_string ns/op", "mutex ns/op" );
+  for( int readers = 1; readers <= 64; readers *= 2 ) {
+    cow::atomic_string atomic;
+    mutex_string       locked;
+    const double a = run( atomic, readers );
+    const double m = run( locked, readers );
+    std::printf( "%8d %20.1f %20.1f\n", readers, a, m );
+  }
+  return 0;
+}
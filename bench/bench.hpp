@@ -0,0 +1,29 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+// Helpers shared by the benchmarks.
+
+#include <chrono>
+#include <cstdio>
+
+using bench_clock = std::chrono::steady_clock;
+
+// Seconds elapsed since 'start'.
+inline double seconds_since( bench_clock::time_point start )
+{
+  return std::chrono::duration<double>( bench_clock::now() - start ).count();
+}
+
+// Keep the compiler from optimizing away a computed value.
+template <class T>
+inline void do_not_optimize( const T& value )
+{
+#if defined(__GNUC__) || defined(__clang__)
+  asm volatile( "" : : "r,m"(value) : "memory" );
+#else
+  static volatile const void* sink;
+  sink = &value;
+#endif
+}
@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+// Sorts random strings, and looks them up in a std::set: std::string,
+// cow::string compared through its characters, and cow::string compared
+// with operator< (which uses the key held in the handle).
+
+#include <cow_string.hpp>
+#include "bench.hpp"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+static const std::size_t kStrings = 1000000;
+
+// Orders strings like operator< does, but always through their characters.
+struct by_characters {
+  bool operator() ( const cow::string& lhs, const cow::string& rhs ) const {
+    const std::size_t n = std::min( lhs.size(), rhs.size() );
+    const int result = std::char_traits<char>::compare( lhs.data(), rhs.data(), n );
+    return result != 0 ? result < 0 : lhs.size() < rhs.size();
+  }
+};
+
+// Seconds to sort 'strings', and to look each one up in a set of them.
+template < class String, class Less >
+static void run( std::vector<String> strings, Less less, double& sort, double& lookup )
+{
+  bench_clock::time_point start = bench_clock::now();
+  std::sort( strings.begin(), strings.end(), less );
+  sort = seconds_since( start );
+
+  std::shuffle( strings.begin(), strings.end(), std::mt19937( 1 ) );
+  std::set<String, Less> set( strings.begin(), strings.begin() + strings.size() / 10, less );
+  std::size_t found = 0;
+  start = bench_clock::now();
+  for( const String& s : strings ) {
+    found += set.count( s );
+  }
+  lookup = seconds_since( start );
+  do_not_optimize( found );
+}
+
+int main()
+{
+  std::printf( "%-12s %-20s %10s %10s\n", "length", "strings", "sort s", "lookup s" );
+  const std::size_t lengths[] = { 12, 64 };
+  for( std::size_t length : lengths ) {
+    std::mt19937 rng( 42 );
+    std::vector<std::string> keys;
+    for( std::size_t i = 0; i < kStrings; ++i ) {
+      std::string key( length, ' ' );
+      for( char& c : key ) {
+        c = char( 'a' + rng() % 26 );
+      }
+      keys.push_back( key );
+    }
+    std::vector<cow::string> cow_keys( keys.begin(), keys.end() );
+
+    double sort, lookup;
+    run( keys, std::less<std::string>(), sort, lookup );
+    std::printf( "%-12zu %-20s %10.3f %10.3f\n", length, "std::string", sort, lookup );
+    run( cow_keys, by_characters(), sort, lookup );
+    std::printf( "%-12zu %-20s %10.3f %10.3f\n", length, "cow (characters)", sort, lookup );
+    run( cow_keys, std::less<cow::string>(), sort, lookup );
+    std::printf( "%-12zu %-20s %10.3f %10.3f\n", length, "cow (operator<)", sort, lookup );
+  }
+  return 0;
+}
@@ -0,0 +1,44 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+// Times the compilation of compile_time_sample.cpp, which uses the four
+// cow::basic_string typedefs: including cow_string.hpp, including it with
+// the extern templates of cow_string_impl, and including cow_string_decl.hpp
+// only.
+
+#include "bench.hpp"
+
+#include <cstdlib>
+#include <string>
+
+static const int kRuns = 5;
+
+// Average seconds to compile the sample with the extra compiler 'flags'.
+static double compile( const std::string& flags )
+{
+  const std::string command =
+    std::string( COMPILE_TIME_CXX ) + " -std=c++17 -O2 -I" COMPILE_TIME_SOURCE_DIR " " + flags +
+    " -c " COMPILE_TIME_SOURCE_DIR "/bench/compile_time_sample.cpp -o compile_time_sample.o";
+  bench_clock::time_point start = bench_clock::now();
+  for( int i = 0; i < kRuns; ++i ) {
+    if( std::system( command.c_str() ) != 0 ) {
+      std::fprintf( stderr, "failed: %s\n", command.c_str() );
+      std::exit( 1 );
+    }
+  }
+  return seconds_since( start ) / kRuns;
+}
+
+int main()
+{
+  const double header = compile( "" );
+  const double extern_templates = compile( "-DCOWSTRING_EXTERN_TEMPLATES" );
+  const double decl = compile( "-DCOWSTRING_EXTERN_TEMPLATES -DCOMPILE_TIME_DECL" );
+  std::printf( "%-36s %10s %8s\n", "compile_time_sample.cpp", "seconds", "speedup" );
+  std::printf( "%-36s %10.3f %8.2f\n", "cow_string.hpp", header, 1.0 );
+  std::printf( "%-36s %10.3f %8.2f\n", "cow_string.hpp + extern templates", extern_templates, header / extern_templates );
+  std::printf( "%-36s %10.3f %8.2f\n", "cow_string_decl.hpp", decl, header / decl );
+  return 0;
+}
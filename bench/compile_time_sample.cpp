@@ -0,0 +1,40 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+// A translation unit using cow::string, u16string, u32string and wstring,
+// compiled by compile_time_bench. With COMPILE_TIME_DECL it includes only the
+// declarations (and must be linked with cow_string_impl).
+
+#if defined(COMPILE_TIME_DECL)
+# include <cow_string_decl.hpp>
+#else
+# include <cow_string.hpp>
+#endif
+
+template < class String >
+std::size_t use( const typename String::value_type* text )
+{
+  typedef typename String::value_type charT;
+  String s( text );
+  String copy( s );
+  copy += s;
+  copy.append( text ).append( 3, charT( 'x' ) );
+  copy.insert( 1, s );
+  copy.replace( 0, 2, s );
+  copy.erase( 0, 1 );
+  copy.resize( copy.size() + 4, charT( 'y' ) );
+  String sub = copy.substr( 2, 5 );
+  String sum = s + sub + charT( '!' ) + text;
+  sum.push_back( charT( '?' ) );
+  sum.shrink_to_fit();
+  return sum.find( sub ) + sum.rfind( charT( 'x' ) ) + copy.size() + copy.capacity() +
+         std::size_t( sum.c_str()[0] );
+}
+
+std::size_t use_all()
+{
+  return use<cow::string>( "text" ) + use<cow::u16string>( u"text" ) +
+         use<cow::u32string>( U"text" ) + use<cow::wstring>( L"text" );
+}
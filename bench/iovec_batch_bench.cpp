@@ -0,0 +1,67 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+// Writes responses made of many small fragments to /dev/null, either
+// concatenated into one string and written with write(2), or gathered with
+// cow::iovec_batch and written with writev(2).
+
+#include <cow_iovec_batch.hpp>
+#include "bench.hpp"
+
+#include <cstdlib>
+#include <fcntl.h>
+#include <string>
+#include <vector>
+
+static const int kResponses = 20000;
+static const int kFragments = 300;
+
+// Returns the average time per response, in microseconds, for concatenating
+// and for gathering fragments of about 'size' characters.
+static void run( int fd, std::size_t size, double& concat, double& gather )
+{
+  std::vector<cow::string> fragments;
+  for( int i = 0; i < kFragments; ++i ) {
+    fragments.push_back( cow::string( std::string( size / 2 + i % size, 'a' + i % 26 ) ) );
+  }
+
+  bench_clock::time_point start = bench_clock::now();
+  for( int r = 0; r < kResponses; ++r ) {
+    std::string response;
+    for( const cow::string& f : fragments ) {
+      response.append( f.data(), f.size() );
+      response.append( ", " );
+    }
+    if( ::write( fd, response.data(), response.size() ) < 0 ) {
+      std::abort();
+    }
+  }
+  concat = seconds_since( start ) * 1e6 / kResponses;
+
+  start = bench_clock::now();
+  cow::iovec_batch batch;
+  for( int r = 0; r < kResponses; ++r ) {
+    for( const cow::string& f : fragments ) {
+      batch.append( f );
+      batch.append_static( ", ", 2 );
+    }
+    batch.flush( fd );
+  }
+  gather = seconds_since( start ) * 1e6 / kResponses;
+}
+
+int main()
+{
+  const int fd = ::open( "/dev/null", O_WRONLY );
+  std::printf( "%-16s %20s %20s\n", "fragment size", "concat+write us/op", "iovec_batch us/op" );
+  const std::size_t sizes[] = { 16, 256, 4096 };
+  for( std::size_t size : sizes ) {
+    double concat, gather;
+    run( fd, size, concat, gather );
+    std::printf( "%-16zu %20.2f %20.2f\n", size, concat, gather );
+  }
+  ::close( fd );
+  return 0;
+}
@@ -0,0 +1,76 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+// Cost of sharing a buffer: copies and destroys a cow::string, on the thread
+// that created it and on another thread. Built once with std::shared_ptr
+// (refcount_bench) and once with COWSTRING_BIASED_REFCOUNT=1
+// (refcount_bench_biased). The baseline is a handle with a plain, non-atomic
+// counter: the owner thread fast path should match it.
+
+#include <cow_string.hpp>
+#include "bench.hpp"
+
+#include <thread>
+
+static const long kCopies = 20000000;
+
+// Intrusive non-atomic reference count, the lower bound for a handle.
+class plain_handle {
+public:
+  explicit plain_handle( const char* s ) : m_block( new block{ 1, s } ) {}
+  plain_handle( const plain_handle& other ) : m_block( other.m_block ) {
+    ++m_block->count;
+  }
+  ~plain_handle() {
+    if( --m_block->count == 0 ) {
+      delete m_block;
+    }
+  }
+private:
+  struct block {
+    long        count;
+    std::string data;
+  };
+  block* m_block;
+};
+
+// Returns the average time of a copy and its destruction, in nanoseconds.
+template <class Handle>
+static double run( const Handle& original )
+{
+  const bench_clock::time_point start = bench_clock::now();
+  for( long i = 0; i < kCopies; ++i ) {
+    Handle copy( original );
+    do_not_optimize( copy );
+  }
+  return seconds_since( start ) * 1e9 / kCopies;
+}
+
+template <class Handle>
+static void report( const char* name, const Handle& original )
+{
+  double foreign = 0;
+  std::thread other( [&] { foreign = run( original ); } );
+  other.join();
+  std::printf( "%-24s %12.2f %12.2f\n", name, run( original ), foreign );
+}
+
+int main()
+{
+#if COWSTRING_BIASED_REFCOUNT
+  typedef cow::_biased_ptr<const char> counter;
+  const char* name = "cow::_biased_ptr";
+#else
+  typedef std::shared_ptr<const char> counter;
+  const char* name = "std::shared_ptr";
+#endif
+  const char* text = "a string long enough to be allocated on the heap";
+
+  std::printf( "%-24s %12s %12s\n", "copy + destroy (ns/op)", "owner", "other thread" );
+  report( "non-atomic baseline", plain_handle( text ) );
+  report( name, counter( new char[8](), []( const char* p ) { delete[] p; } ) );
+  report( "cow::string", cow::string( text ) );
+  return 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+// Sorts random keys sharing prefixes of various lengths (like the keys of an
+// index) with std::sort and cow::sort, and merges sorted runs of them.
+
+#include <cow_sort.hpp>
+#include "bench.hpp"
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+static const std::size_t kStrings = 2000000;
+static const std::size_t kRuns    = 16;
+
+template < class Sort >
+static double time_sort( std::vector<cow::string> strings, Sort sort )
+{
+  const bench_clock::time_point start = bench_clock::now();
+  sort( strings );
+  const double seconds = seconds_since( start );
+  do_not_optimize( strings.front() );
+  return seconds;
+}
+
+int main()
+{
+  const unsigned threads = std::max( 1u, std::thread::hardware_concurrency() );
+  std::printf( "%-12s %-28s %10s\n", "prefix", "algorithm", "seconds" );
+  const std::size_t prefixes[] = { 0, 6, 24 };
+  for( std::size_t prefix : prefixes ) {
+    std::mt19937 rng( 42 );
+    std::vector<cow::string> keys;
+    for( std::size_t i = 0; i < kStrings; ++i ) {
+      std::string key( prefix, '/' );
+      const std::size_t length = 4 + rng() % 24;
+      for( std::size_t j = 0; j < length; ++j ) {
+        key.push_back( char( 'a' + rng() % 26 ) );
+      }
+      keys.push_back( cow::string( key ) );
+    }
+
+    std::printf( "%-12zu %-28s %10.3f\n", prefix, "std::sort",
+      time_sort( keys, []( std::vector<cow::string>& v ) { std::sort( v.begin(), v.end() ); } ) );
+    std::printf( "%-12zu %-28s %10.3f\n", prefix, "std::stable_sort",
+      time_sort( keys, []( std::vector<cow::string>& v ) { std::stable_sort( v.begin(), v.end() ); } ) );
+    std::printf( "%-12zu %-28s %10.3f\n", prefix, "cow::sort",
+      time_sort( keys, []( std::vector<cow::string>& v ) { cow::sort( v.begin(), v.end() ); } ) );
+    std::printf( "%-12zu %-28s %10.3f\n", prefix, "cow::stable_sort",
+      time_sort( keys, []( std::vector<cow::string>& v ) { cow::stable_sort( v.begin(), v.end() ); } ) );
+    std::printf( "%-12zu cow::sort (%2u threads)      %10.3f\n", prefix, threads,
+      time_sort( keys, [threads]( std::vector<cow::string>& v ) { cow::sort( v.begin(), v.end(), threads ); } ) );
+
+    // kRuns sorted runs, merged into one.
+    std::vector< std::vector<cow::string> > runs( kRuns );
+    for( std::size_t i = 0; i < keys.size(); ++i ) {
+      runs[i % kRuns].push_back( keys[i] );
+    }
+    typedef std::move_iterator< std::vector<cow::string>::iterator > iterator;
+    std::vector< std::pair<iterator,iterator> > ranges;
+    for( std::vector<cow::string>& run : runs ) {
+      cow::sort( run.begin(), run.end() );
+      ranges.push_back( std::make_pair( iterator( run.begin() ), iterator( run.end() ) ) );
+    }
+    std::vector<cow::string> merged;
+    merged.reserve( keys.size() );
+    const bench_clock::time_point start = bench_clock::now();
+    cow::merge( ranges, std::back_inserter( merged ) );
+    std::printf( "%-12zu cow::merge (%zu runs)         %10.3f\n", prefix, kRuns, seconds_since( start ) );
+  }
+  return 0;
+}
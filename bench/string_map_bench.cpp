@@ -0,0 +1,82 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+// Looks up symbol names (given as 'const char*') in tables of strings:
+// std::unordered_map needs a string made of each name, cow::string_map
+// hashes and compares the characters as they are.
+
+#include <cow_string_map.hpp>
+#include "bench.hpp"
+
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+static const std::size_t kSymbols = 200000;
+static const std::size_t kLookups = 4000000;
+
+struct cow_hash {
+  std::size_t operator() ( const cow::string& s ) const {
+    return static_cast<std::size_t>( cow::_hash_chars( s.data(), s.size() ) );
+  }
+};
+
+int main()
+{
+  std::mt19937 rng( 42 );
+  std::vector<std::string> names;
+  for( std::size_t i = 0; i < kSymbols; ++i ) {
+    names.push_back( "app::detail::symbol_" + std::to_string( rng() ) );
+  }
+  // Half the lookups miss.
+  std::vector<const char*> probes;
+  std::vector<std::string> misses;
+  for( std::size_t i = 0; i < kSymbols; ++i ) {
+    misses.push_back( names[i] + "_" );
+  }
+  for( std::size_t i = 0; i < kLookups; ++i ) {
+    const std::size_t j = rng() % kSymbols;
+    probes.push_back( i % 2 == 0 ? names[j].c_str() : misses[j].c_str() );
+  }
+
+  std::unordered_map<std::string, int>           std_map;
+  std::unordered_map<cow::string, int, cow_hash> cow_unordered;
+  cow::string_map<int>                           cow_map;
+  for( std::size_t i = 0; i < kSymbols; ++i ) {
+    std_map[names[i]] = int( i );
+    cow_unordered[cow::string( names[i] )] = int( i );
+    cow_map[names[i]] = int( i );
+  }
+
+  std::printf( "%-40s %10s\n", "table (key)", "seconds" );
+  std::size_t found = 0;
+  bench_clock::time_point start = bench_clock::now();
+  for( const char* p : probes ) {
+    found += std_map.count( p );
+  }
+  std::printf( "%-40s %10.3f\n", "std::unordered_map<std::string>", seconds_since( start ) );
+
+  start = bench_clock::now();
+  for( const char* p : probes ) {
+    found += cow_unordered.count( cow::string( p ) );
+  }
+  std::printf( "%-40s %10.3f\n", "std::unordered_map<cow::string>", seconds_since( start ) );
+
+  start = bench_clock::now();
+  for( const char* p : probes ) {
+    found += cow_map.count( p );
+  }
+  std::printf( "%-40s %10.3f\n", "cow::string_map (const char*)", seconds_since( start ) );
+
+  start = bench_clock::now();
+  for( const char* p : probes ) {
+    found += cow_map.count( std::string_view( p ) );
+  }
+  std::printf( "%-40s %10.3f\n", "cow::string_map (std::string_view)", seconds_since( start ) );
+  do_not_optimize( found );
+  return 0;
+}
@@ -0,0 +1,74 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+// Fills, searches and concatenates strings of each character type with
+// std::basic_string and with cow::basic_string, whose searches use the
+// width-specialized _chars kernels.
+
+#include <cow_string.hpp>
+#include "bench.hpp"
+
+#include <string>
+
+static const std::size_t kChars = 1 << 24;  // characters processed per test
+
+// Nanoseconds per character of each test, for strings of 'size' characters.
+template < class String >
+static void run( std::size_t size, double& fill, double& find, double& concat )
+{
+  typedef typename String::value_type charT;
+  const std::size_t iterations = kChars / size;
+
+  bench_clock::time_point start = bench_clock::now();
+  for( std::size_t i = 0; i < iterations; ++i ) {
+    String s( size, charT( 'a' + i % 3 ) );
+    do_not_optimize( s.data() );
+  }
+  fill = seconds_since( start ) * 1e9 / kChars;
+
+  String haystack( size, charT( 'a' ) );
+  haystack[size - 1] = charT( 'z' );
+  const String text( haystack );
+  std::size_t found = 0;
+  start = bench_clock::now();
+  for( std::size_t i = 0; i < iterations; ++i ) {
+    do_not_optimize( text.data() );
+    found += text.find( charT( 'z' ) );
+  }
+  find = seconds_since( start ) * 1e9 / kChars;
+  do_not_optimize( found );
+
+  start = bench_clock::now();
+  for( std::size_t i = 0; i < iterations; ++i ) {
+    String s = text + text;
+    do_not_optimize( s.data() );
+  }
+  concat = seconds_since( start ) * 1e9 / kChars;
+}
+
+template < class charT >
+static void compare( const char* name )
+{
+  const std::size_t sizes[] = { 16, 256, 65536 };
+  for( std::size_t size : sizes ) {
+    double std_fill, std_find, std_concat;
+    double cow_fill, cow_find, cow_concat;
+    run< std::basic_string<charT> >( size, std_fill, std_find, std_concat );
+    run< cow::basic_string<charT> >( size, cow_fill, cow_find, cow_concat );
+    std::printf( "%-10s %8zu %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n", name, size,
+                 std_fill, cow_fill, std_find, cow_find, std_concat, cow_concat );
+  }
+}
+
+int main()
+{
+  std::printf( "%-10s %8s %10s %10s %10s %10s %10s %10s\n", "ns/char", "size",
+               "std fill", "cow fill", "std find", "cow find", "std +", "cow +" );
+  compare<char>( "string" );
+  compare<char16_t>( "u16string" );
+  compare<char32_t>( "u32string" );
+  compare<wchar_t>( "wstring" );
+  return 0;
+}
@@ -0,0 +1,277 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "cow_string.hpp"
+
+namespace cow {
+
+//------------------------------------------------------------------------------
+// ASCII case conversion : cow::to_lower(..), cow::to_upper(..)
+//------------------------------------------------------------------------------
+// Only 'A'-'Z' and 'a'-'z' are converted; other characters (including
+// non-ASCII ones) are copied as they are. If there is nothing to convert,
+// 'str' is returned as it is: a shared string keeps sharing its buffer.
+// Otherwise the result is made in one allocation.
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> to_lower(const cow::basic_string<charT,traits,Alloc>& str);
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> to_upper(const cow::basic_string<charT,traits,Alloc>& str);
+
+
+//------------------------------------------------------------------------------
+// Remove ASCII whitespace : cow::trim(..), cow::ltrim(..), cow::rtrim(..)
+//------------------------------------------------------------------------------
+// Whitespace is " \t\n\v\f\r". If there is none to remove, 'str' is returned
+// as it is; ltrim() (and trim() when the end has none) returns a suffix,
+// which shares the buffer of a shared string (see substr()).
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> trim(const cow::basic_string<charT,traits,Alloc>& str);
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> ltrim(const cow::basic_string<charT,traits,Alloc>& str);
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> rtrim(const cow::basic_string<charT,traits,Alloc>& str);
+
+
+//------------------------------------------------------------------------------
+// ASCII case-insensitive comparison : cow::iequals(..), cow::ifind(..)
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+bool iequals(const cow::basic_string<charT,traits,Alloc>& lhs, const cow::basic_string<charT,traits,Alloc>& rhs);
+template < class charT, class traits, class Alloc >
+bool iequals(const cow::basic_string<charT,traits,Alloc>& lhs, const charT* rhs);
+
+// Position of the first match of 's' at or after 'pos', or npos.
+template < class charT, class traits, class Alloc >
+std::size_t ifind(const cow::basic_string<charT,traits,Alloc>& str, const cow::basic_string<charT,traits,Alloc>& s, std::size_t pos = 0);
+template < class charT, class traits, class Alloc >
+std::size_t ifind(const cow::basic_string<charT,traits,Alloc>& str, const charT* s, std::size_t pos = 0);
+
+
+// Character kernels. Narrow strings are scanned 8 characters at a time, in
+// a 64-bit word (SWAR); wider ones a character at a time.
+template < class charT >
+charT _ascii_lower(charT c) {
+  return (c >= charT('A') && c <= charT('Z')) ? charT(c + ('a' - 'A')) : c;
+}
+
+template < class charT >
+charT _ascii_upper(charT c) {
+  return (c >= charT('a') && c <= charT('z')) ? charT(c - ('a' - 'A')) : c;
+}
+
+template < class charT >
+bool _ascii_space(charT c) {
+  return c == charT(' ') || (c >= charT('\t') && c <= charT('\r'));
+}
+
+// The 0x80 bit of each byte of 'word' that is in ['first', 'last'].
+inline std::uint64_t _ascii_in_range(std::uint64_t word, unsigned char first, unsigned char last) {
+  const std::uint64_t ones = UINT64_C(0x0101010101010101);
+  const std::uint64_t high = ones * 0x80;
+  const std::uint64_t low7 = word & ~high;
+  const std::uint64_t ge_first = low7 + ones * (0x80 - first);
+  const std::uint64_t gt_last  = low7 + ones * (0x7F - last);
+  return ge_first & ~gt_last & ~word & high;
+}
+
+// Index of the first character of [s, s+n) that 'upper' (or lower) case
+// conversion changes, or n.
+template < class charT >
+std::size_t _ascii_first_cased(const charT* s, std::size_t n, bool upper) {
+  std::size_t i = 0;
+  if( sizeof(charT) == 1 ) {
+    const unsigned char first = upper ? 'a' : 'A';
+    for( ; n - i >= 8; i += 8 ) {
+      std::uint64_t word;
+      std::memcpy(&word, s + i, sizeof(word));
+      if( cow::_ascii_in_range(word, first, first + 25) != 0 ) {
+        break;
+      }
+    }
+  }
+  for( ; i < n; ++i ) {
+    if( (upper ? cow::_ascii_upper(s[i]) : cow::_ascii_lower(s[i])) != s[i] ) {
+      break;
+    }
+  }
+  return i;
+}
+
+// Convert the case of [s, s+n) in place.
+template < class charT >
+void _ascii_convert(charT* s, std::size_t n, bool upper) {
+  std::size_t i = 0;
+  if( sizeof(charT) == 1 ) {
+    const unsigned char first = upper ? 'a' : 'A';
+    for( ; n - i >= 8; i += 8 ) {
+      std::uint64_t word;
+      std::memcpy(&word, s + i, sizeof(word));
+      word ^= cow::_ascii_in_range(word, first, first + 25) >> 2;  // 0x80 >> 2 == 'a' - 'A'
+      std::memcpy(s + i, &word, sizeof(word));
+    }
+  }
+  for( ; i < n; ++i ) {
+    s[i] = upper ? cow::_ascii_upper(s[i]) : cow::_ascii_lower(s[i]);
+  }
+}
+
+template < class charT >
+bool _ascii_iequals(const charT* a, const charT* b, std::size_t n) {
+  std::size_t i = 0;
+  if( sizeof(charT) == 1 ) {
+    for( ; n - i >= 8; i += 8 ) {
+      std::uint64_t x, y;
+      std::memcpy(&x, a + i, sizeof(x));
+      std::memcpy(&y, b + i, sizeof(y));
+      if( x == y ) {
+        continue;
+      }
+      x |= cow::_ascii_in_range(x, 'A', 'Z') >> 2;
+      y |= cow::_ascii_in_range(y, 'A', 'Z') >> 2;
+      if( x != y ) {
+        return false;
+      }
+    }
+  }
+  for( ; i < n; ++i ) {
+    if( cow::_ascii_lower(a[i]) != cow::_ascii_lower(b[i]) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> _ascii_case(const cow::basic_string<charT,traits,Alloc>& str, bool upper) {
+  const std::size_t i = cow::_ascii_first_cased(str.data(), str.size(), upper);
+  if( i == str.size() ) {
+    return str;
+  }
+  std::basic_string<charT,traits,Alloc> result(str.data(), str.size());
+  cow::_ascii_convert(&result[i], result.size() - i, upper);
+  return cow::basic_string<charT,traits,Alloc>(std::move(result));
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t _ascii_ifind(const cow::basic_string<charT,traits,Alloc>& str, const charT* s, std::size_t n, std::size_t pos) {
+  const std::size_t size = str.size();
+  if( pos > size || n > size - pos ) {
+    return cow::basic_string<charT,traits,Alloc>::npos;
+  }
+  if( n == 0 ) {
+    return pos;
+  }
+  const charT* data = str.data();
+  const charT lower = cow::_ascii_lower(s[0]);
+  const charT upper = cow::_ascii_upper(s[0]);
+  for( std::size_t i = pos; i <= size - n; ++i ) {
+    if( (data[i] == lower || data[i] == upper) && cow::_ascii_iequals(data + i + 1, s + 1, n - 1) ) {
+      return i;
+    }
+  }
+  return cow::basic_string<charT,traits,Alloc>::npos;
+}
+
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Implementation
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::to_lower(const cow::basic_string<charT,traits,Alloc>& str)
+{
+  return cow::_ascii_case(str, false);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::to_upper(const cow::basic_string<charT,traits,Alloc>& str)
+{
+  return cow::_ascii_case(str, true);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::trim(const cow::basic_string<charT,traits,Alloc>& str)
+{
+  const charT* data = str.data();
+  std::size_t last = str.size();
+  while( last != 0 && cow::_ascii_space(data[last - 1]) ) {
+    --last;
+  }
+  std::size_t first = 0;
+  while( first != last && cow::_ascii_space(data[first]) ) {
+    ++first;
+  }
+  if( last == str.size() ) {
+    return first == 0 ? str : str.substr(first);
+  }
+  return str.substr(first, last - first);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::ltrim(const cow::basic_string<charT,traits,Alloc>& str)
+{
+  const charT* data = str.data();
+  std::size_t first = 0;
+  while( first != str.size() && cow::_ascii_space(data[first]) ) {
+    ++first;
+  }
+  return first == 0 ? str : str.substr(first);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::rtrim(const cow::basic_string<charT,traits,Alloc>& str)
+{
+  const charT* data = str.data();
+  std::size_t last = str.size();
+  while( last != 0 && cow::_ascii_space(data[last - 1]) ) {
+    --last;
+  }
+  return last == str.size() ? str : str.substr(0, last);
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::iequals(const cow::basic_string<charT,traits,Alloc>& lhs, const cow::basic_string<charT,traits,Alloc>& rhs)
+{
+  return lhs.size() == rhs.size() && cow::_ascii_iequals(lhs.data(), rhs.data(), lhs.size());
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::iequals(const cow::basic_string<charT,traits,Alloc>& lhs, const charT* rhs)
+{
+  const std::size_t n = traits::length(rhs);
+  return lhs.size() == n && cow::_ascii_iequals(lhs.data(), rhs, n);
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::ifind(const cow::basic_string<charT,traits,Alloc>& str, const cow::basic_string<charT,traits,Alloc>& s, std::size_t pos)
+{
+  return cow::_ascii_ifind(str, s.data(), s.size(), pos);
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::ifind(const cow::basic_string<charT,traits,Alloc>& str, const charT* s, std::size_t pos)
+{
+  return cow::_ascii_ifind(str, s, traits::length(s), pos);
+}
@@ -0,0 +1,425 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "cow_string.hpp"
+
+// Bits of the node addresses that basic_atomic_string packs with a
+// reference count (the others must be zero). Define to 57 with 5-level page
+// tables, for instance. Nodes that don't fit are handled under a mutex.
+#if !defined(COWSTRING_ATOMIC_POINTER_BITS)
+# define COWSTRING_ATOMIC_POINTER_BITS (sizeof(void*) == 8 ? 48 : 32)
+#endif
+
+namespace cow {
+
+//----------------------------------------------------------------------------
+// Template declaration : Atomic Copy-On-Write (COW) Basic String
+//----------------------------------------------------------------------------
+// Holds a cow::basic_string that can be replaced by one thread while others
+// take snapshots of it, without a mutex.
+//
+// load() is wait-free. store(), exchange() and compare_exchange_*() are
+// lock-free. Each stored value lives in a node, and the node pointer is
+// packed with an "external" reference count in a single 64-bit word:
+//
+//   - load() increments the external count (a single fetch_add, so it pins
+//     the node it read), copies the string and then decrements the node's
+//     "internal" count.
+//   - store() swaps in a new node and adds the external count it swapped out
+//     to the old node's internal count, which therefore reaches zero exactly
+//     when the last reader of the old node is done.
+//
+// The external count is allowed to wrap: the load that wraps it adds the
+// wrapped amount to the internal count instead.
+//
+// A node whose address doesn't fit in COWSTRING_ATOMIC_POINTER_BITS (e.g.
+// with tagged heap pointers) is stored as an odd id instead, and loads and
+// compare_exchange_*() of it hold a mutex while they use it: only then are
+// they blocking, and then they (and store(), exchange()) throw
+// std::system_error if locking it fails.
+template < class charT,
+           class traits = std::char_traits<charT>,
+           class Alloc = std::allocator<charT>
+           >
+class basic_atomic_string
+{
+public:
+  typedef cow::basic_string<charT,traits,Alloc> value_type;
+
+  basic_atomic_string();
+  basic_atomic_string(const value_type& str);
+  ~basic_atomic_string();
+
+  basic_atomic_string(const basic_atomic_string&) = delete;
+  basic_atomic_string& operator= (const basic_atomic_string&) = delete;
+
+  //----------------------------------------------------------------------------
+  // Read & write the string
+  //----------------------------------------------------------------------------
+  // Returns a snapshot sharing the stored buffer.
+  value_type load() const;
+  void       store(const value_type& str);
+  value_type exchange(const value_type& str);
+
+  // Replaces the string with 'desired' if it still shares the buffer of
+  // 'expected' (typically a previous load()). Otherwise 'expected' is set to
+  // the current string. Like std::atomic<std::shared_ptr>, buffers are
+  // compared, not characters. The weak version tries once, so it may also
+  // fail when a concurrent load() changed the reference count.
+  bool compare_exchange_strong(value_type& expected, const value_type& desired);
+  bool compare_exchange_weak  (value_type& expected, const value_type& desired);
+
+  bool is_lock_free() const noexcept;
+
+  operator value_type() const;
+  basic_atomic_string& operator= (const value_type& str);
+
+private:
+  typedef std::uint64_t word_type;
+
+  struct node {
+    explicit node(const value_type& str);
+    // Always read-only, so that copies share it.
+    const value_type        value;
+    std::atomic<std::int64_t> internal;
+    word_type               id;  // if locked: its odd id in m_word
+  };
+
+  // A node in use: kept by its internal count, or if locked by m_mutex.
+  struct pin {
+    word_type                    word;
+    node*                        n;
+    std::unique_lock<std::mutex> lock;
+  };
+
+  // Low bits: node pointer or locked id. High bits: external reference count.
+  static const unsigned  kPointerBits = COWSTRING_ATOMIC_POINTER_BITS;
+  static const word_type kPointerMask = (word_type(1) << kPointerBits) - 1;
+  static const word_type kExternalOne = word_type(1) << kPointerBits;
+  static const word_type kExternalMax = ~word_type(0) >> kPointerBits;
+  // Internal count of a node while it is stored, so it can't reach zero.
+  static const std::int64_t kStored = std::int64_t(1) << 62;
+
+  // The word of a new node, which is registered as locked if its address
+  // doesn't fit.
+  word_type    _pack(node* n);
+  static node* _unpack(word_type word);
+  static bool  _is_locked(word_type word) { return (word & 1) != 0; }
+  // Locked only: the node of 'word', or nullptr once it is retired.
+  node*        _find_locked(word_type word) const;
+  // The node of a word this thread swapped out, before retiring it.
+  node*        _swapped_out(word_type word) const;
+
+  // Pin the current node.
+  pin  _pin() const;
+  void _unpin(pin& p) const noexcept;
+  // Pin the current node. Returns the word after the increment.
+  word_type _acquire() const noexcept;
+  // Unpin a node pinned by _acquire().
+  static void _release(node* n) noexcept;
+  // Hand over the external count of a node that was swapped out (or drop
+  // a locked node).
+  void _retire(word_type old);
+  // Drop a node that was never stored.
+  void _discard(node* n);
+  bool _compare_exchange(value_type& expected, const value_type& desired, bool weak);
+
+  mutable std::atomic<word_type> m_word;
+  // Locked nodes, rarely any.
+  mutable std::mutex             m_mutex;
+  std::vector<node*>             m_locked;
+  word_type                      m_next_id;
+
+}; // template class basic_atomic_string
+
+
+//------------------------------------------------------------------------------
+// Class instantiations
+//------------------------------------------------------------------------------
+typedef cow::basic_atomic_string<char>      atomic_string;
+typedef cow::basic_atomic_string<char16_t>  atomic_u16string;
+typedef cow::basic_atomic_string<char32_t>  atomic_u32string;
+typedef cow::basic_atomic_string<wchar_t>   atomic_wstring;
+
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Implementation
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+cow::basic_atomic_string<charT,traits,Alloc>::node::node(const value_type& str)
+: value(str)
+, internal(kStored)
+, id(0)
+{
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_atomic_string<charT,traits,Alloc>::basic_atomic_string()
+: m_word(0)
+, m_next_id(1)
+{
+  m_word.store(_pack(new node(value_type())), std::memory_order_relaxed);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_atomic_string<charT,traits,Alloc>::basic_atomic_string(const value_type& str)
+: m_word(0)
+, m_next_id(1)
+{
+  m_word.store(_pack(new node(str)), std::memory_order_relaxed);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_atomic_string<charT,traits,Alloc>::~basic_atomic_string()
+{
+  // No other thread uses it anymore: no need to lock.
+  const word_type word = m_word.load(std::memory_order_acquire);
+  delete (_is_locked(word) ? _find_locked(word) : _unpack(word));
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_atomic_string<charT,traits,Alloc>::value_type
+cow::basic_atomic_string<charT,traits,Alloc>::load() const
+{
+  pin p = _pin();
+  value_type result(p.n->value);
+  _unpin(p);
+  return result;
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_atomic_string<charT,traits,Alloc>::store(const value_type& str)
+{
+  _retire(m_word.exchange(_pack(new node(str)), std::memory_order_acq_rel));
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_atomic_string<charT,traits,Alloc>::value_type
+cow::basic_atomic_string<charT,traits,Alloc>::exchange(const value_type& str)
+{
+  const word_type old = m_word.exchange(_pack(new node(str)), std::memory_order_acq_rel);
+  // Other readers may still be copying the old value, so copy it too.
+  value_type result(_swapped_out(old)->value);
+  _retire(old);
+  return result;
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::basic_atomic_string<charT,traits,Alloc>::compare_exchange_strong(
+  value_type& expected,
+  const value_type& desired)
+{
+  return _compare_exchange(expected, desired, false);
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::basic_atomic_string<charT,traits,Alloc>::compare_exchange_weak(
+  value_type& expected,
+  const value_type& desired)
+{
+  return _compare_exchange(expected, desired, true);
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::basic_atomic_string<charT,traits,Alloc>::_compare_exchange(
+  value_type& expected,
+  const value_type& desired,
+  bool weak)
+{
+  // Allocate first: nothing may throw while a node is pinned.
+  node* fresh = new node(desired);
+  const word_type desired_word = _pack(fresh);
+  for(;;) {
+    pin p = _pin();
+    if( p.n->value.data() == expected.data() && p.n->value.size() == expected.size() ) {
+      // Concurrent loads change the external count: retry while 'p.n' is
+      // stored (or give up after one try if weak).
+      word_type word = p.word;
+      do {
+        if( m_word.compare_exchange_weak(word, desired_word,
+                                         std::memory_order_acq_rel,
+                                         std::memory_order_acquire) ) {
+          _unpin(p);
+          _retire(word);
+          return true;
+        }
+      } while( !weak && (word & kPointerMask) == (p.word & kPointerMask) );
+      if( !weak ) {
+        _unpin(p);
+        continue;
+      }
+    }
+    expected = p.n->value;
+    _unpin(p);
+    _discard(fresh);
+    return false;
+  }
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::basic_atomic_string<charT,traits,Alloc>::is_lock_free() const noexcept
+{
+  return m_word.is_lock_free();
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_atomic_string<charT,traits,Alloc>::operator value_type() const
+{
+  return load();
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_atomic_string<charT,traits,Alloc>&
+cow::basic_atomic_string<charT,traits,Alloc>::operator= (const value_type& str)
+{
+  store(str);
+  return *this;
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_atomic_string<charT,traits,Alloc>::word_type
+cow::basic_atomic_string<charT,traits,Alloc>::_pack(node* n)
+{
+  const word_type word = reinterpret_cast<std::uintptr_t>(n);
+  if( (word & ~kPointerMask) == 0 ) {
+    return word;
+  }
+  // The address doesn't leave room for the external count.
+  std::lock_guard<std::mutex> lock(m_mutex);
+  n->id = m_next_id;
+  m_next_id = (m_next_id + 2) & kPointerMask;
+  m_locked.push_back(n);
+  return n->id;
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_atomic_string<charT,traits,Alloc>::node*
+cow::basic_atomic_string<charT,traits,Alloc>::_unpack(word_type word)
+{
+  return reinterpret_cast<node*>(static_cast<std::uintptr_t>(word & kPointerMask));
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_atomic_string<charT,traits,Alloc>::node*
+cow::basic_atomic_string<charT,traits,Alloc>::_find_locked(word_type word) const
+{
+  for( std::size_t i = 0; i < m_locked.size(); ++i ) {
+    if( m_locked[i]->id == (word & kPointerMask) ) {
+      return m_locked[i];
+    }
+  }
+  return nullptr;
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_atomic_string<charT,traits,Alloc>::node*
+cow::basic_atomic_string<charT,traits,Alloc>::_swapped_out(word_type word) const
+{
+  if( !_is_locked(word) ) {
+    return _unpack(word);
+  }
+  std::lock_guard<std::mutex> lock(m_mutex);
+  return _find_locked(word);
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_atomic_string<charT,traits,Alloc>::pin
+cow::basic_atomic_string<charT,traits,Alloc>::_pin() const
+{
+  for(;;) {
+    pin p;
+    p.word = _acquire();
+    if( !_is_locked(p.word) ) {
+      p.n = _unpack(p.word);
+      return p;
+    }
+    p.lock = std::unique_lock<std::mutex>(m_mutex);
+    p.n = _find_locked(p.word);
+    if( p.n != nullptr ) {
+      return p;
+    }
+    // Retired meanwhile: read the new word.
+  }
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_atomic_string<charT,traits,Alloc>::_unpin(pin& p) const noexcept
+{
+  if( p.lock.owns_lock() ) {
+    p.lock.unlock();
+  } else {
+    _release(p.n);
+  }
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_atomic_string<charT,traits,Alloc>::word_type
+cow::basic_atomic_string<charT,traits,Alloc>::_acquire() const noexcept
+{
+  const word_type old = m_word.fetch_add(kExternalOne, std::memory_order_acquire);
+  if( (old >> kPointerBits) == kExternalMax && !_is_locked(old) ) {
+    // This increment wrapped the external count back to zero.
+    _unpack(old)->internal.fetch_add(std::int64_t(kExternalMax) + 1, std::memory_order_relaxed);
+  }
+  return old + kExternalOne;
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_atomic_string<charT,traits,Alloc>::_release(node* n) noexcept
+{
+  if( n->internal.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+    delete n;
+  }
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_atomic_string<charT,traits,Alloc>::_retire(word_type old)
+{
+  if( _is_locked(old) ) {
+    // Readers only use it holding the mutex.
+    _discard(_swapped_out(old));
+    return;
+  }
+  node* n = _unpack(old);
+  const std::int64_t delta = std::int64_t(old >> kPointerBits) - kStored;
+  if( n->internal.fetch_add(delta, std::memory_order_acq_rel) + delta == 0 ) {
+    delete n;
+  }
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_atomic_string<charT,traits,Alloc>::_discard(node* n)
+{
+  if( n->id != 0 ) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for( std::size_t i = 0; i < m_locked.size(); ++i ) {
+      if( m_locked[i] == n ) {
+        m_locked[i] = m_locked.back();
+        m_locked.pop_back();
+        break;
+      }
+    }
+  }
+  delete n;
+}
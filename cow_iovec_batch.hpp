@@ -0,0 +1,291 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#if !defined(__unix__) && !defined(__APPLE__)
+# error "cow_iovec_batch.hpp requires writev(2)"
+#endif
+
+#include <cerrno>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "cow_string.hpp"
+
+namespace cow {
+
+//----------------------------------------------------------------------------
+// Template declaration : Scatter-gather output of cow strings
+//----------------------------------------------------------------------------
+// Collects fragments (whole strings, substrings and static characters) and
+// writes them to a file descriptor with writev(2), without concatenating
+// them first.
+//
+// The batch holds a copy of each string it was given, so shared buffers stay
+// alive until they are flushed. Adjacent fragments of the same buffer are
+// merged into one iovec.
+template < class charT,
+           class traits = std::char_traits<charT>,
+           class Alloc = std::allocator<charT>
+           >
+class basic_iovec_batch
+{
+public:
+  typedef cow::basic_string<charT,traits,Alloc> string_type;
+
+  basic_iovec_batch();
+
+  //----------------------------------------------------------------------------
+  // Add fragments
+  //----------------------------------------------------------------------------
+  // string (1)
+  basic_iovec_batch& append(const string_type& str);
+  // substring (2)
+  basic_iovec_batch& append(const string_type& str, std::size_t pos, std::size_t len = string_type::npos);
+  // static characters (3): 's' must outlive the batch (e.g. a string literal).
+  basic_iovec_batch& append_static(const charT* s);
+  basic_iovec_batch& append_static(const charT* s, std::size_t n);
+
+  basic_iovec_batch& operator<< (const string_type& str);
+
+  //----------------------------------------------------------------------------
+  // Write
+  //----------------------------------------------------------------------------
+  // Writes every fragment to 'fd', retrying on partial writes and EINTR, then
+  // clears the batch. Returns the number of bytes written.
+  // Throws std::system_error if writev fails: the fragments written so far
+  // are removed, so flush() can be called again (e.g. after EAGAIN).
+  std::size_t flush(int fd);
+
+  //----------------------------------------------------------------------------
+  // Capacity
+  //----------------------------------------------------------------------------
+  std::size_t fragments() const;  // number of iovecs
+  std::size_t bytes() const;      // bytes left to write
+  bool        empty() const;
+  void        clear();
+
+private:
+  void _push(const void* data, std::size_t bytes);
+
+  std::vector<struct iovec> m_iovecs;
+  std::size_t               m_first;  // first iovec not written yet
+  std::size_t               m_bytes;
+  // Keep the buffers alive: moving a cow::basic_string doesn't move its
+  // characters, so m_iovecs stay valid when this grows.
+  std::vector<string_type>  m_strings;
+
+}; // template class basic_iovec_batch
+
+
+//------------------------------------------------------------------------------
+// Write strings to a file descriptor : cow::write_all(..)
+//------------------------------------------------------------------------------
+// Writes [first, last) with as few writev(2) calls as possible.
+// Throws std::system_error if writev fails.
+template < class InputIterator >
+std::size_t write_all(int fd, InputIterator first, InputIterator last);
+
+template < class charT, class traits, class Alloc >
+std::size_t write_all(int fd, const cow::basic_string<charT,traits,Alloc>& str);
+
+
+//------------------------------------------------------------------------------
+// Class instantiations
+//------------------------------------------------------------------------------
+typedef cow::basic_iovec_batch<char>      iovec_batch;
+typedef cow::basic_iovec_batch<char16_t>  u16iovec_batch;
+typedef cow::basic_iovec_batch<char32_t>  u32iovec_batch;
+typedef cow::basic_iovec_batch<wchar_t>   wiovec_batch;
+
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Implementation
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+cow::basic_iovec_batch<charT,traits,Alloc>::basic_iovec_batch()
+: m_iovecs()
+, m_first(0)
+, m_bytes(0)
+, m_strings()
+{
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_iovec_batch<charT,traits,Alloc>&
+cow::basic_iovec_batch<charT,traits,Alloc>::append(const string_type& str)
+{
+  return append(str, 0, str.size());
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_iovec_batch<charT,traits,Alloc>&
+cow::basic_iovec_batch<charT,traits,Alloc>::append(
+  const string_type& str,
+  std::size_t pos,
+  std::size_t len)
+{
+  if( pos > str.size() ) {
+    throw std::out_of_range("cow::basic_iovec_batch");
+  }
+  if( len > str.size() - pos ) {
+    len = str.size() - pos;
+  }
+  if( len == 0 ) {
+    return *this;
+  }
+  // Share the buffer before taking its address: copying a writeable string
+  // makes a new buffer.
+  if( m_strings.empty() || m_strings.back().data() != str.data() ) {
+    m_strings.push_back(str);
+  }
+  _push(m_strings.back().data() + pos, len * sizeof(charT));
+  return *this;
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_iovec_batch<charT,traits,Alloc>&
+cow::basic_iovec_batch<charT,traits,Alloc>::append_static(const charT* s)
+{
+  return append_static(s, traits::length(s));
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_iovec_batch<charT,traits,Alloc>&
+cow::basic_iovec_batch<charT,traits,Alloc>::append_static(const charT* s, std::size_t n)
+{
+  if( n != 0 ) {
+    _push(s, n * sizeof(charT));
+  }
+  return *this;
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_iovec_batch<charT,traits,Alloc>&
+cow::basic_iovec_batch<charT,traits,Alloc>::operator<< (const string_type& str)
+{
+  return append(str);
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_iovec_batch<charT,traits,Alloc>::flush(int fd)
+{
+#if defined(IOV_MAX)
+  const std::size_t max_iovecs = IOV_MAX;
+#else
+  const std::size_t max_iovecs = 1024;
+#endif
+  std::size_t written = 0;
+  while( m_first < m_iovecs.size() ) {
+    std::size_t count = m_iovecs.size() - m_first;
+    if( count > max_iovecs ) {
+      count = max_iovecs;
+    }
+    const ssize_t n = ::writev(fd, &m_iovecs[m_first], static_cast<int>(count));
+    if( n < 0 ) {
+      if( errno == EINTR ) {
+        continue;
+      }
+      throw std::system_error(errno, std::generic_category(), "writev");
+    }
+    written += static_cast<std::size_t>(n);
+    m_bytes -= static_cast<std::size_t>(n);
+    // Skip the iovecs written in full, then trim a partially written one.
+    std::size_t left = static_cast<std::size_t>(n);
+    while( m_first < m_iovecs.size() && left >= m_iovecs[m_first].iov_len ) {
+      left -= m_iovecs[m_first].iov_len;
+      ++m_first;
+    }
+    if( left != 0 ) {
+      struct iovec& partial = m_iovecs[m_first];
+      partial.iov_base = static_cast<char*>(partial.iov_base) + left;
+      partial.iov_len -= left;
+    }
+  }
+  clear();
+  return written;
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_iovec_batch<charT,traits,Alloc>::fragments() const
+{
+  return m_iovecs.size() - m_first;
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_iovec_batch<charT,traits,Alloc>::bytes() const
+{
+  return m_bytes;
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::basic_iovec_batch<charT,traits,Alloc>::empty() const
+{
+  return m_bytes == 0;
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_iovec_batch<charT,traits,Alloc>::clear()
+{
+  m_iovecs.clear();
+  m_first = 0;
+  m_bytes = 0;
+  m_strings.clear();
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_iovec_batch<charT,traits,Alloc>::_push(const void* data, std::size_t bytes)
+{
+  m_bytes += bytes;
+  if( m_iovecs.size() > m_first ) {
+    struct iovec& last = m_iovecs.back();
+    if( static_cast<const char*>(last.iov_base) + last.iov_len == data ) {
+      last.iov_len += bytes;
+      return;
+    }
+  }
+  struct iovec iov;
+  iov.iov_base = const_cast<void*>(data);
+  iov.iov_len  = bytes;
+  m_iovecs.push_back(iov);
+}
+
+template < class InputIterator >
+std::size_t
+cow::write_all(int fd, InputIterator first, InputIterator last)
+{
+  typedef typename std::iterator_traits<InputIterator>::value_type string_type;
+  typedef typename string_type::value_type charT;
+  cow::basic_iovec_batch<charT, typename string_type::traits_type,
+                         typename string_type::allocator_type> batch;
+  for( ; first != last; ++first ) {
+    batch.append(*first);
+  }
+  return batch.flush(fd);
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::write_all(int fd, const cow::basic_string<charT,traits,Alloc>& str)
+{
+  return cow::basic_iovec_batch<charT,traits,Alloc>().append(str).flush(fd);
+}
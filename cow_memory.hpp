@@ -0,0 +1,299 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "cow_string.hpp"
+
+namespace cow {
+
+//------------------------------------------------------------------------------
+// Memory used by many strings : cow::memory_report(..)
+//------------------------------------------------------------------------------
+// Adds up the memory_footprint() of each string, counting each buffer once
+// however many strings of the range share it. Sizes are in bytes.
+struct memory_summary {
+  std::size_t strings;        // handles in the range
+  std::size_t buffers;        // distinct character buffers
+  std::size_t handle_bytes;   // the handles themselves
+  std::size_t unique_bytes;   // buffers (with their control blocks) used by one handle
+  std::size_t shared_bytes;   // buffers used by several handles, counted once
+  std::size_t saved_bytes;    // what sharing saves: the copies the handles would otherwise need
+  std::size_t wasted_bytes;   // allocated beyond the characters' size
+  std::size_t mapped_bytes;   // file mappings (see map_file), not in the above
+
+  // Heap memory actually used.
+  std::size_t total_bytes() const { return handle_bytes + unique_bytes + shared_bytes; }
+  // Average number of handles per buffer (1 if nothing is shared).
+  double sharing_factor() const { return buffers == 0 ? 1.0 : double(strings) / double(buffers); }
+};
+
+template < class InputIterator >
+cow::memory_summary memory_report(InputIterator first, InputIterator last);
+template < class Range >
+cow::memory_summary memory_report(const Range& strings);
+
+
+
+//------------------------------------------------------------------------------
+// Share identical buffers : cow::deduplicate(..)
+//------------------------------------------------------------------------------
+// Hashes the strings of [first, last), groups the ones with equal characters
+// and makes each group share one buffer: the most shared one already there
+// (immortal buffers first). Returns the bytes released: buffers that no
+// other string (in the range or elsewhere) still uses.
+//
+// The parallel overload hashes on 'threads' threads, then has each thread
+// merge the groups of its share of the hash values, so no string is touched
+// by two threads. Strings of the range mustn't be used by other threads
+// meanwhile.
+template < class ForwardIterator >
+std::size_t deduplicate(ForwardIterator first, ForwardIterator last);
+template < class ForwardIterator >
+std::size_t deduplicate(ForwardIterator first, ForwardIterator last, unsigned threads);
+
+
+// 64-bit hash of the bytes of [s, s+n), read 8 at a time.
+template < class charT >
+std::uint64_t _hash_chars(const charT* s, std::size_t n) {
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(s);
+  std::size_t bytes = n * sizeof(charT);
+  const std::uint64_t k = UINT64_C(0x9E3779B97F4A7C15);
+  std::uint64_t h = UINT64_C(0xCBF29CE484222325) ^ (bytes * k);
+  for( ; bytes >= 8; bytes -= 8, p += 8 ) {
+    std::uint64_t w;
+    std::memcpy(&w, p, sizeof(w));
+    h = (h ^ w) * k;
+    h ^= h >> 32;
+  }
+  std::uint64_t tail = 0;
+  std::memcpy(&tail, p, bytes);
+  h = (h ^ tail) * k;
+  return h ^ (h >> 29);
+}
+
+// The strings being deduplicated, with their footprints taken beforehand by
+// the calling thread (in biased mode, only it sees the whole use count).
+template < class String >
+struct _deduplicate_input {
+  std::vector<String*>               strings;
+  std::vector<cow::memory_footprint> footprints;
+  std::vector<std::uint64_t>         hashes;
+};
+
+// Makes the strings 'group' (indices of equal strings) share one buffer.
+// Returns the bytes released.
+template < class String >
+std::size_t _deduplicate_group(const _deduplicate_input<String>& in, const std::vector<std::size_t>& group) {
+  struct buffer {
+    const void* id;
+    long        use_count;
+    std::size_t handles;
+    std::size_t bytes;
+    String*     str;
+  };
+  std::vector<buffer> buffers;
+  for( std::size_t i = 0; i < group.size(); ++i ) {
+    const cow::memory_footprint& f = in.footprints[group[i]];
+    std::size_t j = 0;
+    while( j < buffers.size() && buffers[j].id != f.buffer ) {
+      ++j;
+    }
+    if( j == buffers.size() ) {
+      const buffer b = { f.buffer, f.use_count, 0, 0, in.strings[group[i]] };
+      buffers.push_back(b);
+    }
+    ++buffers[j].handles;
+    if( f.control_bytes + f.char_bytes > buffers[j].bytes ) {
+      buffers[j].bytes = f.control_bytes + f.char_bytes;
+    }
+  }
+  if( buffers.size() < 2 ) {
+    return 0;
+  }
+  std::size_t canonical = 0;
+  for( std::size_t j = 1; j < buffers.size(); ++j ) {
+    const long a = buffers[j].use_count == 0 ? LONG_MAX : buffers[j].use_count;
+    const long b = buffers[canonical].use_count == 0 ? LONG_MAX : buffers[canonical].use_count;
+    if( a > b ) {
+      canonical = j;
+    }
+  }
+  long long released = 0;
+  const void* keep = buffers[canonical].id;
+  const String shared(*buffers[canonical].str);
+  if( shared.data() != buffers[canonical].str->data() ) {
+    // Copying a writeable string made a new shared buffer: it replaces the
+    // canonical one too.
+    const cow::memory_footprint f = shared.memory_footprint();
+    released -= static_cast<long long>(f.control_bytes + f.char_bytes);
+    keep = nullptr;
+  }
+  for( std::size_t j = 0; j < buffers.size(); ++j ) {
+    if( buffers[j].id != keep && buffers[j].use_count == long(buffers[j].handles) ) {
+      released += static_cast<long long>(buffers[j].bytes);
+    }
+  }
+  for( std::size_t i = 0; i < group.size(); ++i ) {
+    if( in.footprints[group[i]].buffer != keep ) {
+      *in.strings[group[i]] = shared;
+    }
+  }
+  return released > 0 ? static_cast<std::size_t>(released) : 0;
+}
+
+// Deduplicates the strings whose hash is 'shard' modulo 'shards'.
+template < class String >
+std::size_t _deduplicate_shard(const _deduplicate_input<String>& in, std::size_t shard, std::size_t shards) {
+  typedef typename String::traits_type traits;
+  typedef std::unordered_map< std::uint64_t, std::vector<std::size_t> > hash_map;
+  hash_map by_hash;
+  for( std::size_t i = 0; i < in.strings.size(); ++i ) {
+    if( in.hashes[i] % shards == shard ) {
+      by_hash[in.hashes[i]].push_back(i);
+    }
+  }
+  std::size_t released = 0;
+  std::vector<std::size_t> group;
+  std::vector<std::size_t> rest;
+  for( typename hash_map::iterator it = by_hash.begin(); it != by_hash.end(); ++it ) {
+    std::vector<std::size_t>& candidates = it->second;
+    // Split hash collisions into groups of equal strings.
+    while( candidates.size() > 1 ) {
+      const String& key = *in.strings[candidates[0]];
+      group.clear();
+      rest.clear();
+      for( std::size_t i = 0; i < candidates.size(); ++i ) {
+        const String& s = *in.strings[candidates[i]];
+        const bool equal = s.size() == key.size() &&
+          (s.data() == key.data() || traits::compare(s.data(), key.data(), s.size()) == 0);
+        (equal ? group : rest).push_back(candidates[i]);
+      }
+      released += cow::_deduplicate_group(in, group);
+      candidates.swap(rest);
+    }
+  }
+  return released;
+}
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Implementation
+//------------------------------------------------------------------------------
+template < class InputIterator >
+cow::memory_summary
+cow::memory_report(InputIterator first, InputIterator last)
+{
+  struct buffer {
+    std::size_t handles;
+    std::size_t bytes;   // control block and characters
+    std::size_t wasted;
+    std::size_t mapped;
+  };
+  cow::memory_summary report = cow::memory_summary();
+  std::unordered_map<const void*, buffer> buffers;
+  for( ; first != last; ++first ) {
+    const cow::memory_footprint f = first->memory_footprint();
+    ++report.strings;
+    report.handle_bytes += f.handle_bytes;
+    buffer& b = buffers[f.buffer];
+    ++b.handles;
+    // Every string sharing the buffer (suffixes too) reports all of it.
+    b.bytes  = f.control_bytes + f.char_bytes;
+    b.wasted = f.wasted_bytes();
+    b.mapped = f.mapped_bytes;
+  }
+  report.buffers = buffers.size();
+  for( typename std::unordered_map<const void*, buffer>::const_iterator it = buffers.begin();
+       it != buffers.end(); ++it ) {
+    const buffer& b = it->second;
+    if( b.handles > 1 ) {
+      report.shared_bytes += b.bytes;
+      report.saved_bytes  += (b.handles - 1) * b.bytes;
+    } else {
+      report.unique_bytes += b.bytes;
+    }
+    report.wasted_bytes += b.wasted;
+    report.mapped_bytes += b.mapped;
+  }
+  return report;
+}
+
+template < class Range >
+cow::memory_summary
+cow::memory_report(const Range& strings)
+{
+  using std::begin;
+  using std::end;
+  return cow::memory_report(begin(strings), end(strings));
+}
+
+template < class ForwardIterator >
+std::size_t
+cow::deduplicate(ForwardIterator first, ForwardIterator last)
+{
+  return cow::deduplicate(first, last, 1);
+}
+
+template < class ForwardIterator >
+std::size_t
+cow::deduplicate(ForwardIterator first, ForwardIterator last, unsigned threads)
+{
+  typedef typename std::iterator_traits<ForwardIterator>::value_type String;
+  cow::_deduplicate_input<String> in;
+  for( ; first != last; ++first ) {
+    in.strings.push_back(&*first);
+    in.footprints.push_back(first->memory_footprint());
+  }
+  const std::size_t n = in.strings.size();
+  in.hashes.resize(n);
+  if( threads == 0 ) {
+    threads = 1;
+  }
+  if( threads > n / 1024 + 1 ) {
+    threads = static_cast<unsigned>(n / 1024 + 1);  // not worth it
+  }
+  if( threads == 1 ) {
+    for( std::size_t i = 0; i < n; ++i ) {
+      in.hashes[i] = cow::_hash_chars(in.strings[i]->data(), in.strings[i]->size());
+    }
+    return cow::_deduplicate_shard(in, 0, 1);
+  }
+  std::vector<std::thread> workers;
+  for( unsigned t = 0; t < threads; ++t ) {
+    workers.push_back(std::thread([&in, n, t, threads]() {
+      for( std::size_t i = t; i < n; i += threads ) {
+        in.hashes[i] = cow::_hash_chars(in.strings[i]->data(), in.strings[i]->size());
+      }
+    }));
+  }
+  for( unsigned t = 0; t < threads; ++t ) {
+    workers[t].join();
+  }
+  workers.clear();
+  std::vector<std::size_t> released(threads);
+  for( unsigned t = 0; t < threads; ++t ) {
+    workers.push_back(std::thread([&in, &released, t, threads]() {
+      released[t] = cow::_deduplicate_shard(in, t, threads);
+    }));
+  }
+  std::size_t total = 0;
+  for( unsigned t = 0; t < threads; ++t ) {
+    workers[t].join();
+    total += released[t];
+  }
+  return total;
+}
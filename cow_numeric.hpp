@@ -0,0 +1,279 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#if __cplusplus < 201703L
+# error "cow_numeric.hpp requires C++17 <charconv>"
+#endif
+
+#include <cctype>
+#include <charconv>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+
+#include "cow_string.hpp"
+
+namespace cow {
+
+//----------------------------------------------------------------------------
+// Convert numerical value to string : cow::to_string(..)
+//----------------------------------------------------------------------------
+// Formatted with std::to_chars into a stack buffer, then copied once into
+// the new string. Integers from 0 to 255 share static strings and don't
+// allocate. Floating-point values use the shortest representation that
+// reads back to the same value (std::to_string uses "%f" instead).
+cow::string to_string(int value);
+cow::string to_string(long value);
+cow::string to_string(long long value);
+cow::string to_string(unsigned value);
+cow::string to_string(unsigned long value);
+cow::string to_string(unsigned long long value);
+cow::string to_string(float value);
+cow::string to_string(double value);
+cow::string to_string(long double value);
+
+
+//----------------------------------------------------------------------------
+// Convert string to number : cow::stoi(..), cow::stod(..), ..
+//----------------------------------------------------------------------------
+// Parse the characters of 'str' in place, with std::from_chars. Like the
+// std:: functions, they skip leading whitespace, accept a '+' sign, and a
+// "0x" prefix in base 16 (and base 0, which also reads a leading '0' as
+// octal); they store the number of characters used in '*idx'. They throw
+// std::invalid_argument if no number is found and std::out_of_range if it
+// doesn't fit in the result type.
+int                stoi  (const cow::string& str, std::size_t* idx = nullptr, int base = 10);
+long               stol  (const cow::string& str, std::size_t* idx = nullptr, int base = 10);
+long long          stoll (const cow::string& str, std::size_t* idx = nullptr, int base = 10);
+unsigned long      stoul (const cow::string& str, std::size_t* idx = nullptr, int base = 10);
+unsigned long long stoull(const cow::string& str, std::size_t* idx = nullptr, int base = 10);
+float              stof  (const cow::string& str, std::size_t* idx = nullptr);
+double             stod  (const cow::string& str, std::size_t* idx = nullptr);
+long double        stold (const cow::string& str, std::size_t* idx = nullptr);
+
+
+//----------------------------------------------------------------------------
+// Parse delimited numbers : cow::parse_fields<T>(..)
+//----------------------------------------------------------------------------
+// Parses each 'delim'-separated field of 'str' (e.g. a CSV row) as a T and
+// writes it to 'out'. Whitespace around numbers is skipped. Returns the
+// number of fields. Throws like cow::stoi if a field isn't a T.
+template < class T, class OutputIterator >
+std::size_t parse_fields(const cow::string& str, char delim, OutputIterator out);
+template < class T, class OutputIterator >
+std::size_t parse_fields(const char* first, const char* last, char delim, OutputIterator out);
+
+
+// Parses a number at the start of [first, last) into 'value', skipping
+// leading whitespace. Returns the end of the number. 'name' is the message
+// of the exceptions.
+template < class T >
+const char* _parse_number(const char* first, const char* last, T& value, int base, const char* name);
+
+inline bool _is_space(char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+template < class T >
+T _sto(const cow::string& str, std::size_t* idx, int base, const char* name) {
+  T value;
+  const char* end = cow::_parse_number(str.data(), str.data() + str.size(), value, base, name);
+  if( idx != nullptr ) {
+    *idx = static_cast<std::size_t>(end - str.data());
+  }
+  return value;
+}
+
+// "0" to "255", NUL-terminated.
+struct _small_numbers {
+  constexpr _small_numbers() : text() {
+    for( int i = 0; i < 256; ++i ) {
+      int n = 0;
+      if( i >= 100 ) text[i][n++] = char('0' + i / 100);
+      if( i >= 10 )  text[i][n++] = char('0' + i / 10 % 10);
+      text[i][n++] = char('0' + i % 10);
+    }
+  }
+  char text[256][4];
+};
+
+inline const char* _small_number(int i) {
+  static constexpr _small_numbers table;
+  return table.text[i];
+}
+
+template < class T >
+cow::string _to_string(T value) {
+  if constexpr( std::is_integral<T>::value ) {
+    if( value >= T(0) && value <= T(255) ) {
+      const int i = static_cast<int>(value);
+      return cow::string::from_static(cow::_small_number(i), i >= 100 ? 3 : i >= 10 ? 2 : 1);
+    }
+  }
+  // Enough for any integer, and for the shortest round-trip form of any
+  // float, double or 80/128-bit long double.
+  char buffer[64];
+  const std::to_chars_result result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  return cow::string(buffer, static_cast<std::size_t>(result.ptr - buffer));
+}
+
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Implementation
+//------------------------------------------------------------------------------
+inline cow::string cow::to_string(int value)                { return cow::_to_string(value); }
+inline cow::string cow::to_string(long value)               { return cow::_to_string(value); }
+inline cow::string cow::to_string(long long value)          { return cow::_to_string(value); }
+inline cow::string cow::to_string(unsigned value)           { return cow::_to_string(value); }
+inline cow::string cow::to_string(unsigned long value)      { return cow::_to_string(value); }
+inline cow::string cow::to_string(unsigned long long value) { return cow::_to_string(value); }
+inline cow::string cow::to_string(float value)              { return cow::_to_string(value); }
+inline cow::string cow::to_string(double value)             { return cow::_to_string(value); }
+inline cow::string cow::to_string(long double value)        { return cow::_to_string(value); }
+
+inline int
+cow::stoi(const cow::string& str, std::size_t* idx, int base)
+{
+  const long value = cow::_sto<long>(str, idx, base, "cow::stoi");
+  if( value < std::numeric_limits<int>::min() || value > std::numeric_limits<int>::max() ) {
+    throw std::out_of_range("cow::stoi");
+  }
+  return static_cast<int>(value);
+}
+
+inline long
+cow::stol(const cow::string& str, std::size_t* idx, int base)
+{
+  return cow::_sto<long>(str, idx, base, "cow::stol");
+}
+
+inline long long
+cow::stoll(const cow::string& str, std::size_t* idx, int base)
+{
+  return cow::_sto<long long>(str, idx, base, "cow::stoll");
+}
+
+inline unsigned long
+cow::stoul(const cow::string& str, std::size_t* idx, int base)
+{
+  return cow::_sto<unsigned long>(str, idx, base, "cow::stoul");
+}
+
+inline unsigned long long
+cow::stoull(const cow::string& str, std::size_t* idx, int base)
+{
+  return cow::_sto<unsigned long long>(str, idx, base, "cow::stoull");
+}
+
+inline float
+cow::stof(const cow::string& str, std::size_t* idx)
+{
+  return cow::_sto<float>(str, idx, 10, "cow::stof");
+}
+
+inline double
+cow::stod(const cow::string& str, std::size_t* idx)
+{
+  return cow::_sto<double>(str, idx, 10, "cow::stod");
+}
+
+inline long double
+cow::stold(const cow::string& str, std::size_t* idx)
+{
+  return cow::_sto<long double>(str, idx, 10, "cow::stold");
+}
+
+template < class T, class OutputIterator >
+std::size_t
+cow::parse_fields(const cow::string& str, char delim, OutputIterator out)
+{
+  return cow::parse_fields<T>(str.data(), str.data() + str.size(), delim, out);
+}
+
+template < class T, class OutputIterator >
+std::size_t
+cow::parse_fields(const char* first, const char* last, char delim, OutputIterator out)
+{
+  std::size_t count = 0;
+  for( ;; ) {
+    T value;
+    const char* p = cow::_parse_number(first, last, value, 10, "cow::parse_fields");
+    while( p != last && *p != delim && cow::_is_space(*p) ) {
+      ++p;
+    }
+    if( p != last && *p != delim ) {
+      throw std::invalid_argument("cow::parse_fields");
+    }
+    *out = value;
+    ++out;
+    ++count;
+    if( p == last ) {
+      return count;
+    }
+    first = p + 1;
+  }
+}
+
+template < class T >
+const char*
+cow::_parse_number(const char* first, const char* last, T& value, int base, const char* name)
+{
+  while( first != last && cow::_is_space(*first) ) {
+    ++first;
+  }
+  bool negative = false;
+  if( first != last && (*first == '+' || *first == '-') ) {
+    negative = *first == '-';
+    ++first;
+  }
+  std::from_chars_result result;
+  if constexpr( std::is_floating_point<T>::value ) {
+    (void)base;
+    if( first != last && *first == '-' ) {
+      throw std::invalid_argument(name);  // "--1" or "+-1"
+    }
+    result = std::from_chars(first, last, value);
+    if( negative ) {
+      value = -value;
+    }
+  } else {
+    if( (base == 0 || base == 16) && last - first > 2 && first[0] == '0' &&
+        (first[1] == 'x' || first[1] == 'X') && std::isxdigit(static_cast<unsigned char>(first[2])) ) {
+      first += 2;
+      base = 16;
+    } else if( base == 0 ) {
+      base = first != last && *first == '0' ? 8 : 10;
+    }
+    // Parse the magnitude, so that the most negative value fits.
+    typedef typename std::make_unsigned<T>::type magnitude_type;
+    magnitude_type magnitude = 0;
+    result = std::from_chars(first, last, magnitude, base);
+    if( result.ec == std::errc() ) {
+      if( std::is_unsigned<T>::value ) {
+        // Like strtoul: "-n" is the negation of n, modulo 2^N.
+        value = static_cast<T>(negative ? magnitude_type(0) - magnitude : magnitude);
+      } else if( negative ? magnitude > magnitude_type(std::numeric_limits<T>::max()) + 1
+                          : magnitude > magnitude_type(std::numeric_limits<T>::max()) ) {
+        result.ec = std::errc::result_out_of_range;
+      } else {
+        value = negative ? static_cast<T>(magnitude_type(0) - magnitude) : static_cast<T>(magnitude);
+      }
+    }
+  }
+  if( result.ec == std::errc::invalid_argument ) {
+    throw std::invalid_argument(name);
+  }
+  if( result.ec == std::errc::result_out_of_range ) {
+    throw std::out_of_range(name);
+  }
+  return result.ptr;
+}
@@ -0,0 +1,404 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "cow_string.hpp"
+
+namespace cow {
+
+//----------------------------------------------------------------------------
+// Sharing-preserving binary format
+//----------------------------------------------------------------------------
+// A stream of 64-bit words and characters, in native byte order:
+//
+//   header:     u32 magic "COWS", u16 version, u16 sizeof(charT)
+//   string:     u64 (length << 1), 'length' characters, a NUL character,
+//               zero padding to a multiple of 8 bytes
+//   reference:  u64 (index << 1) | 1, for a string sharing the buffer of the
+//               index-th string written in full
+//
+// Every word is 8-byte aligned and every string is NUL-terminated, so a
+// loaded image (e.g. cow::string::map_file) can be read without copying.
+struct serializer_format {
+  static const std::uint32_t kMagic   = 0x53574F43;  // "COWS"
+  static const std::uint16_t kVersion = 1;
+};
+
+
+//----------------------------------------------------------------------------
+// Template declaration : Sharing-preserving serializer
+//----------------------------------------------------------------------------
+// Writes each shared buffer once: other strings sharing it are written as
+// references. The serializer holds a copy of each buffer it has written, so
+// that their addresses identify them until it is destroyed.
+template < class charT,
+           class traits = std::char_traits<charT>,
+           class Alloc = std::allocator<charT>
+           >
+class basic_serializer
+{
+public:
+  typedef cow::basic_string<charT,traits,Alloc> string_type;
+
+  // Writes the header to 'os', which must be opened in binary mode.
+  explicit basic_serializer(std::ostream& os);
+
+  basic_serializer(const basic_serializer&) = delete;
+  basic_serializer& operator= (const basic_serializer&) = delete;
+
+  basic_serializer& write(const string_type& str);
+  basic_serializer& operator<< (const string_type& str);
+
+  std::size_t   strings() const;  // strings written
+  std::size_t   buffers() const;  // strings written in full
+  std::uint64_t bytes() const;    // bytes written, header included
+
+private:
+  struct written {
+    std::uint64_t index;
+    string_type   keep;
+  };
+
+  void _write(const void* data, std::size_t bytes);
+  void _write_word(std::uint64_t word);
+
+  std::ostream&                                   m_os;
+  std::unordered_map<const charT*, written>       m_written;
+  std::size_t                                     m_strings;
+  std::size_t                                     m_buffers;
+  std::uint64_t                                   m_bytes;
+
+}; // template class basic_serializer
+
+
+//----------------------------------------------------------------------------
+// Template declaration : Sharing-preserving deserializer
+//----------------------------------------------------------------------------
+// Reads strings written by basic_serializer; strings that shared a buffer
+// when they were written share one again.
+template < class charT,
+           class traits = std::char_traits<charT>,
+           class Alloc = std::allocator<charT>
+           >
+class basic_deserializer
+{
+public:
+  typedef cow::basic_string<charT,traits,Alloc> string_type;
+
+  // Streaming: reads the header from 'is', which must be opened in binary
+  // mode. Each string read in full is copied into a new buffer.
+  explicit basic_deserializer(std::istream& is);
+  // Zero-copy: the strings read point into 'image' (e.g. the result of
+  // string_type::map_file), which stays alive while any of them does.
+  explicit basic_deserializer(const string_type& image);
+
+  basic_deserializer(const basic_deserializer&) = delete;
+  basic_deserializer& operator= (const basic_deserializer&) = delete;
+
+  // Reads the next string. Returns false at the end of the input.
+  // Throws std::runtime_error if the input is truncated or corrupt.
+  bool read(string_type& str);
+
+  std::size_t strings() const;  // strings read
+  std::size_t buffers() const;  // strings read in full
+
+private:
+  void _read_header();
+  bool _read_word(std::uint64_t& word);
+  void _read(void* data, std::size_t bytes);
+  string_type _read_string(std::size_t length);
+  static void _fail(const char* what);
+
+  std::istream*            m_is;
+  string_type              m_image;
+  std::size_t              m_offset;  // in m_image, in bytes
+  std::vector<string_type> m_buffers;
+  std::size_t              m_strings;
+
+}; // template class basic_deserializer
+
+
+//------------------------------------------------------------------------------
+// Class instantiations
+//------------------------------------------------------------------------------
+typedef cow::basic_serializer<char>        serializer;
+typedef cow::basic_serializer<char16_t>    u16serializer;
+typedef cow::basic_serializer<char32_t>    u32serializer;
+typedef cow::basic_serializer<wchar_t>     wserializer;
+
+typedef cow::basic_deserializer<char>      deserializer;
+typedef cow::basic_deserializer<char16_t>  u16deserializer;
+typedef cow::basic_deserializer<char32_t>  u32deserializer;
+typedef cow::basic_deserializer<wchar_t>   wdeserializer;
+
+
+// Bytes taken by a string written in full.
+inline std::uint64_t _serialized_bytes(std::uint64_t length, std::size_t char_size) {
+  return 8 + (((length + 1) * char_size + 7) & ~std::uint64_t(7));
+}
+
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Implementation : basic_serializer
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+cow::basic_serializer<charT,traits,Alloc>::basic_serializer(std::ostream& os)
+: m_os(os)
+, m_written()
+, m_strings(0)
+, m_buffers(0)
+, m_bytes(0)
+{
+  const std::uint32_t magic = cow::serializer_format::kMagic;
+  const std::uint16_t version = cow::serializer_format::kVersion;
+  const std::uint16_t char_size = sizeof(charT);
+  _write(&magic, sizeof(magic));
+  _write(&version, sizeof(version));
+  _write(&char_size, sizeof(char_size));
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_serializer<charT,traits,Alloc>&
+cow::basic_serializer<charT,traits,Alloc>::write(const string_type& str)
+{
+  ++m_strings;
+  typename std::unordered_map<const charT*, written>::const_iterator it = m_written.find(str.data());
+  if( it != m_written.end() && it->second.keep.size() == str.size() ) {
+    _write_word((it->second.index << 1) | 1);
+    return *this;
+  }
+  const std::uint64_t index = m_buffers++;
+  _write_word(std::uint64_t(str.size()) << 1);
+  _write(str.data(), str.size() * sizeof(charT));
+  static const char zeros[8 + sizeof(charT)] = {};
+  const std::uint64_t total = cow::_serialized_bytes(str.size(), sizeof(charT));
+  _write(zeros, static_cast<std::size_t>(total - 8 - str.size() * sizeof(charT)));
+  // Copying a writeable string makes a new buffer: only shared ones are
+  // worth remembering.
+  string_type keep(str);
+  if( keep.data() == str.data() ) {
+    written& w = m_written[keep.data()];
+    w.index = index;
+    w.keep = keep;
+  }
+  return *this;
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_serializer<charT,traits,Alloc>&
+cow::basic_serializer<charT,traits,Alloc>::operator<< (const string_type& str)
+{
+  return write(str);
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_serializer<charT,traits,Alloc>::strings() const
+{
+  return m_strings;
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_serializer<charT,traits,Alloc>::buffers() const
+{
+  return m_buffers;
+}
+
+template < class charT, class traits, class Alloc >
+std::uint64_t
+cow::basic_serializer<charT,traits,Alloc>::bytes() const
+{
+  return m_bytes;
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_serializer<charT,traits,Alloc>::_write(const void* data, std::size_t bytes)
+{
+  m_os.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+  m_bytes += bytes;
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_serializer<charT,traits,Alloc>::_write_word(std::uint64_t word)
+{
+  _write(&word, sizeof(word));
+}
+
+
+//------------------------------------------------------------------------------
+// Implementation : basic_deserializer
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+cow::basic_deserializer<charT,traits,Alloc>::basic_deserializer(std::istream& is)
+: m_is(&is)
+, m_image()
+, m_offset(0)
+, m_buffers()
+, m_strings(0)
+{
+  _read_header();
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_deserializer<charT,traits,Alloc>::basic_deserializer(const string_type& image)
+: m_is(nullptr)
+, m_image(image)
+, m_offset(0)
+, m_buffers()
+, m_strings(0)
+{
+  _read_header();
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::basic_deserializer<charT,traits,Alloc>::read(string_type& str)
+{
+  std::uint64_t word;
+  if( !_read_word(word) ) {
+    return false;
+  }
+  if( (word & 1) != 0 ) {
+    if( (word >> 1) >= m_buffers.size() ) {
+      _fail("reference to an unknown string");
+    }
+    str = m_buffers[static_cast<std::size_t>(word >> 1)];
+  } else {
+    if( (word >> 1) > str.max_size() ) {
+      _fail("string too long");
+    }
+    m_buffers.push_back(_read_string(static_cast<std::size_t>(word >> 1)));
+    str = m_buffers.back();
+  }
+  ++m_strings;
+  return true;
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_deserializer<charT,traits,Alloc>::strings() const
+{
+  return m_strings;
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_deserializer<charT,traits,Alloc>::buffers() const
+{
+  return m_buffers.size();
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_deserializer<charT,traits,Alloc>::_read_header()
+{
+  std::uint32_t magic;
+  std::uint16_t version;
+  std::uint16_t char_size;
+  _read(&magic, sizeof(magic));
+  _read(&version, sizeof(version));
+  _read(&char_size, sizeof(char_size));
+  if( magic != cow::serializer_format::kMagic ) {
+    _fail("not a cow string stream, or written with another byte order");
+  }
+  if( version != cow::serializer_format::kVersion ) {
+    _fail("unsupported version");
+  }
+  if( char_size != sizeof(charT) ) {
+    _fail("written with another character type");
+  }
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::basic_deserializer<charT,traits,Alloc>::_read_word(std::uint64_t& word)
+{
+  if( m_is != nullptr ) {
+    if( m_is->peek() == std::istream::traits_type::eof() ) {
+      return false;
+    }
+  } else if( m_offset == m_image.size() * sizeof(charT) ) {
+    return false;
+  }
+  _read(&word, sizeof(word));
+  return true;
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_deserializer<charT,traits,Alloc>::_read(void* data, std::size_t bytes)
+{
+  if( m_is != nullptr ) {
+    if( !m_is->read(static_cast<char*>(data), static_cast<std::streamsize>(bytes)) ) {
+      _fail("truncated input");
+    }
+    return;
+  }
+  if( bytes > m_image.size() * sizeof(charT) - m_offset ) {
+    _fail("truncated input");
+  }
+  std::memcpy(data, reinterpret_cast<const char*>(m_image.data()) + m_offset, bytes);
+  m_offset += bytes;
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_deserializer<charT,traits,Alloc>::string_type
+cow::basic_deserializer<charT,traits,Alloc>::_read_string(std::size_t length)
+{
+  const std::uint64_t total = cow::_serialized_bytes(length, sizeof(charT));
+  if( m_is != nullptr ) {
+    // The length isn't trusted: grow the string as characters arrive (at
+    // most doubling it), so that a corrupt length fails as truncated input
+    // instead of allocating it up front.
+    std::basic_string<charT,traits,Alloc> str;
+    std::size_t done = 0;
+    while( done != length ) {
+      const std::size_t chunk = std::max<std::size_t>(done, 65536 / sizeof(charT));
+      const std::size_t n = std::min(chunk, length - done);
+      str.resize(done + n);
+      _read(&str[done], n * sizeof(charT));
+      done += n;
+    }
+    char padding[8 + sizeof(charT)];
+    _read(padding, static_cast<std::size_t>(total - 8 - length * sizeof(charT)));
+    return string_type(std::move(str));
+  }
+  if( total - 8 > m_image.size() * sizeof(charT) - m_offset ) {
+    _fail("truncated input");
+  }
+  const charT* data = reinterpret_cast<const charT*>(
+    reinterpret_cast<const char*>(m_image.data()) + m_offset);
+  if( !traits::eq(data[length], charT()) ) {
+    _fail("string not NUL-terminated");
+  }
+  m_offset += static_cast<std::size_t>(total - 8);
+  string_type result;
+  if( length != 0 ) {
+    result._set_readonly(typename string_type::_shared_chars(m_image.m_ro_string, data), length);
+  }
+  return result;
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_deserializer<charT,traits,Alloc>::_fail(const char* what)
+{
+  throw std::runtime_error(std::string("cow::basic_deserializer: ") + what);
+}
@@ -0,0 +1,1024 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#if !defined(__unix__) && !defined(__APPLE__)
+# error "cow_shm_string.hpp requires POSIX shared memory"
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#if __cplusplus >= 201703L
+# include <string_view>
+#endif
+
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "cow_string.hpp"
+
+namespace cow {
+
+template < class charT, class traits, class Alloc > class basic_shm_string;
+
+//----------------------------------------------------------------------------
+// Class declaration : POSIX shared-memory segment for cow strings
+//----------------------------------------------------------------------------
+// A named segment (shm_open + mmap) holding the buffers of basic_shm_string.
+// Every process maps it at its own address, so buffers are addressed by
+// offsets from the start of the segment.
+//
+// Each buffer has one atomic count of all its references, which decides when
+// it is freed, and also counts them per process: a process attached to the
+// segment owns one of kMaxProcesses slots, and slot 0 counts references
+// published in the segment itself (see basic_shm_string::publish). When a
+// process dies without detaching, recover() takes the references of its slot
+// off the total. A reference is added to the total before its slot and taken
+// off its slot before the total, so a process dying in between leaks the
+// buffer rather than have it freed early.
+//
+// Buffers are allocated by a first-fit allocator with power-of-two free
+// lists, guarded by a lock that records the holder's pid so that it can be
+// taken over from a dead process. Freed blocks are reused but not coalesced.
+class shm_segment
+{
+public:
+  static const std::size_t kMaxProcesses = 32;
+
+  // Creates and maps a new segment of 'bytes' bytes, which must not exist.
+  shm_segment(const char* name, std::size_t bytes);
+  // Maps an existing segment.
+  explicit shm_segment(const char* name);
+  // Detaches. The strings of this process must have been destroyed.
+  ~shm_segment();
+
+  shm_segment(const shm_segment&) = delete;
+  shm_segment& operator= (const shm_segment&) = delete;
+
+  // Removes the name: the memory is released when the last process unmaps it.
+  static void unlink(const char* name);
+
+  // Drops the references held by processes that died while attached, and
+  // frees the buffers they were the last to reference. Returns the number
+  // of buffers freed. Also called when all slots are taken.
+  std::size_t recover();
+
+  std::size_t size() const;       // bytes mapped
+  std::size_t used() const;       // bytes in allocated blocks
+  std::size_t processes() const;  // processes attached
+
+private:
+  template < class C, class T, class A > friend class basic_shm_string;
+
+  struct header;
+  struct block;
+
+  void _map(const char* name, int fd, std::size_t bytes);
+  void _attach();
+  block* _block(std::uint64_t offset) const;
+  std::uint64_t _allocate(std::size_t bytes);  // returns a block, counted once by this process
+  void _acquire(std::uint64_t offset);
+  void _release(std::uint64_t offset);
+  void _acquire_published(std::uint64_t offset);
+  void _release_published(std::uint64_t offset);
+  void _release_slot(std::uint64_t offset, std::size_t slot);
+  bool _drop(std::uint64_t offset, std::uint32_t count);
+  long _use_count(std::uint64_t offset) const;
+  void _free(std::uint64_t offset);
+  void _lock();
+  void _unlock();
+  static bool _is_dead(std::int32_t pid);
+
+  header*     m_header;
+  std::size_t m_size;
+  std::size_t m_slot;
+
+}; // class shm_segment
+
+
+//----------------------------------------------------------------------------
+// Template declaration : Copy-On-Write (COW) string in shared memory
+//----------------------------------------------------------------------------
+// A handle to characters in a shm_segment. Copies share the buffer, also
+// across processes (see publish/attach), and the first write through a
+// shared handle copies the characters to a new buffer in the segment.
+//
+// Handles are local to the process (and the shm_segment object) that made
+// them. To hand a string to another process, publish() it, send the offset
+// (e.g. through a pipe or a table in the segment) and attach() it there. A
+// fork()ed child must open the segment again rather than use the handles it
+// inherited, which count in its parent's slot.
+//
+// Besides the access below, handles search and compare the characters in
+// place (find, rfind, compare, ==, <, and a std::basic_string_view in C++17),
+// so reading one doesn't need a private copy; substr() copies only its part.
+template < class charT,
+           class traits = std::char_traits<charT>,
+           class Alloc = std::allocator<charT>
+           >
+class basic_shm_string
+{
+public:
+  typedef cow::basic_string<charT,traits,Alloc> string_type;
+  typedef const charT*                          const_iterator;
+  typedef charT*                                iterator;
+
+  static const std::size_t npos = std::size_t(-1);
+
+  explicit basic_shm_string(cow::shm_segment& segment);
+  basic_shm_string(cow::shm_segment& segment, const charT* s, std::size_t n);
+  basic_shm_string(cow::shm_segment& segment, const string_type& str);
+  basic_shm_string(const basic_shm_string& str);
+  basic_shm_string(basic_shm_string&& str) noexcept;
+  ~basic_shm_string();
+
+  basic_shm_string& operator= (const basic_shm_string& str);
+  basic_shm_string& operator= (basic_shm_string&& str) noexcept;
+  void swap(basic_shm_string& str) noexcept;
+
+  //----------------------------------------------------------------------------
+  // Share between processes
+  //----------------------------------------------------------------------------
+  // Adds a reference owned by the segment and returns the buffer's offset.
+  // Exactly one attach(.., adopt=true) or unpublish() must follow.
+  std::uint64_t publish() const;
+  // A handle to a published buffer. With 'adopt', takes over the published
+  // reference instead of adding one.
+  static basic_shm_string attach(cow::shm_segment& segment, std::uint64_t offset, bool adopt = false);
+  // Drops a published reference.
+  static void unpublish(cow::shm_segment& segment, std::uint64_t offset);
+
+  //----------------------------------------------------------------------------
+  // Access
+  //----------------------------------------------------------------------------
+  std::size_t  size() const;
+  std::size_t  length() const;
+  bool         empty() const;
+  const charT* data() const;
+  const charT* c_str() const;
+  const charT& operator[] (std::size_t pos) const;
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  // Write access: copies the characters first if the buffer is shared.
+  charT&   operator[] (std::size_t pos);
+  iterator begin();
+  iterator end();
+
+  //----------------------------------------------------------------------------
+  // Search & compare, in the segment
+  //----------------------------------------------------------------------------
+  std::size_t find (const basic_shm_string& str, std::size_t pos = 0) const;
+  std::size_t find (const string_type& str, std::size_t pos = 0) const;
+  std::size_t find (const charT* s, std::size_t pos = 0) const;
+  std::size_t find (const charT* s, std::size_t pos, std::size_t n) const;
+  std::size_t find (charT c, std::size_t pos = 0) const;
+  std::size_t rfind(const basic_shm_string& str, std::size_t pos = npos) const;
+  std::size_t rfind(const string_type& str, std::size_t pos = npos) const;
+  std::size_t rfind(const charT* s, std::size_t pos = npos) const;
+  std::size_t rfind(const charT* s, std::size_t pos, std::size_t n) const;
+  std::size_t rfind(charT c, std::size_t pos = npos) const;
+
+  int compare(const basic_shm_string& str) const;
+  int compare(const string_type& str) const;
+  int compare(const charT* s) const;
+
+#if __cplusplus >= 201703L
+  operator std::basic_string_view<charT,traits>() const;
+#endif
+
+  // A private copy of [pos, pos+n). Throws std::out_of_range if pos > size().
+  string_type   substr(std::size_t pos = 0, std::size_t n = npos) const;
+  string_type   str() const;        // a private copy
+  std::uint64_t offset() const;     // 0 for the empty string
+  long          use_count() const;  // references in all processes
+  cow::shm_segment& segment() const;
+
+private:
+  void _detach();
+
+  cow::shm_segment* m_segment;
+  std::uint64_t     m_offset;
+
+}; // template class basic_shm_string
+
+template < class charT, class traits, class Alloc >
+bool operator== (const basic_shm_string<charT,traits,Alloc>& lhs, const basic_shm_string<charT,traits,Alloc>& rhs);
+template < class charT, class traits, class Alloc >
+bool operator== (const basic_shm_string<charT,traits,Alloc>& lhs, const cow::basic_string<charT,traits,Alloc>& rhs);
+template < class charT, class traits, class Alloc >
+bool operator== (const cow::basic_string<charT,traits,Alloc>& lhs, const basic_shm_string<charT,traits,Alloc>& rhs);
+template < class charT, class traits, class Alloc >
+bool operator== (const basic_shm_string<charT,traits,Alloc>& lhs, const charT* rhs);
+template < class charT, class traits, class Alloc >
+bool operator!= (const basic_shm_string<charT,traits,Alloc>& lhs, const basic_shm_string<charT,traits,Alloc>& rhs);
+template < class charT, class traits, class Alloc >
+bool operator!= (const basic_shm_string<charT,traits,Alloc>& lhs, const cow::basic_string<charT,traits,Alloc>& rhs);
+template < class charT, class traits, class Alloc >
+bool operator!= (const cow::basic_string<charT,traits,Alloc>& lhs, const basic_shm_string<charT,traits,Alloc>& rhs);
+template < class charT, class traits, class Alloc >
+bool operator!= (const basic_shm_string<charT,traits,Alloc>& lhs, const charT* rhs);
+template < class charT, class traits, class Alloc >
+bool operator<  (const basic_shm_string<charT,traits,Alloc>& lhs, const basic_shm_string<charT,traits,Alloc>& rhs);
+
+
+//------------------------------------------------------------------------------
+// Class instantiations
+//------------------------------------------------------------------------------
+typedef cow::basic_shm_string<char>      shm_string;
+typedef cow::basic_shm_string<char16_t>  shm_u16string;
+typedef cow::basic_shm_string<char32_t>  shm_u32string;
+typedef cow::basic_shm_string<wchar_t>   shm_wstring;
+
+
+//------------------------------------------------------------------------------
+// Segment layout
+//------------------------------------------------------------------------------
+struct shm_segment::header {
+  static const std::uint32_t kMagic   = 0x4D485343;  // "CSHM"
+  static const std::uint32_t kVersion = 2;
+  static const std::size_t   kClasses = 64;
+
+  std::atomic<std::uint32_t> magic;
+  std::uint32_t              version;
+  std::uint64_t              size;
+  std::atomic<std::int32_t>  lock;     // pid of the holder, 0 if free
+  std::atomic<std::int32_t>  pids[kMaxProcesses];  // pids[0] unused
+  // Guarded by 'lock':
+  std::uint64_t              top;      // end of the blocks carved so far
+  std::uint64_t              used;
+  std::uint64_t              free_lists[kClasses];
+};
+
+struct shm_segment::block {
+  static const std::uint32_t kFree = 0;
+  static const std::uint32_t kUsed = 1;
+  static const std::uint32_t kDead = 2;  // being freed
+
+  std::uint64_t              size;     // bytes, header included
+  std::atomic<std::uint32_t> state;
+  std::uint32_t              reserved;
+  std::uint64_t              length;   // bytes of characters
+  std::uint64_t              next;     // free list
+  std::atomic<std::uint32_t> total;    // references in all processes
+  std::uint32_t              reserved2;
+  std::atomic<std::uint32_t> counts[kMaxProcesses];  // for recover()
+
+  char* chars() { return reinterpret_cast<char*>(this + 1); }
+};
+
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Implementation : shm_segment
+//------------------------------------------------------------------------------
+inline cow::shm_segment::shm_segment(const char* name, std::size_t bytes)
+: m_header(nullptr)
+, m_size(0)
+, m_slot(0)
+{
+  const int fd = ::shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+  if( fd < 0 ) {
+    throw std::system_error(errno, std::generic_category(), name);
+  }
+  if( bytes < sizeof(header) + sizeof(block) ) {
+    bytes = sizeof(header) + sizeof(block);
+  }
+  if( ::ftruncate(fd, static_cast<off_t>(bytes)) != 0 ) {
+    const int err = errno;
+    ::close(fd);
+    ::shm_unlink(name);
+    throw std::system_error(err, std::generic_category(), name);
+  }
+  _map(name, fd, bytes);
+  // The pages are zero: set what isn't.
+  m_header->size = bytes;
+  m_header->top = (sizeof(header) + 63) & ~std::uint64_t(63);
+  m_header->version = header::kVersion;
+  m_header->magic.store(header::kMagic, std::memory_order_release);
+  _attach();
+}
+
+inline cow::shm_segment::shm_segment(const char* name)
+: m_header(nullptr)
+, m_size(0)
+, m_slot(0)
+{
+  const int fd = ::shm_open(name, O_RDWR, 0);
+  if( fd < 0 ) {
+    throw std::system_error(errno, std::generic_category(), name);
+  }
+  struct stat st;
+  if( ::fstat(fd, &st) != 0 ) {
+    const int err = errno;
+    ::close(fd);
+    throw std::system_error(err, std::generic_category(), name);
+  }
+  _map(name, fd, static_cast<std::size_t>(st.st_size));
+  if( m_size < sizeof(header) ||
+      m_header->magic.load(std::memory_order_acquire) != header::kMagic ||
+      m_header->version != header::kVersion ) {
+    ::munmap(m_header, m_size);
+    throw std::system_error(EINVAL, std::generic_category(), name);
+  }
+  _attach();
+}
+
+inline cow::shm_segment::~shm_segment()
+{
+  // Keep the slot if this is a copy inherited by a fork()ed child.
+  std::int32_t pid = static_cast<std::int32_t>(::getpid());
+  m_header->pids[m_slot].compare_exchange_strong(pid, 0, std::memory_order_acq_rel);
+  ::munmap(m_header, m_size);
+}
+
+inline void
+cow::shm_segment::unlink(const char* name)
+{
+  if( ::shm_unlink(name) != 0 ) {
+    throw std::system_error(errno, std::generic_category(), name);
+  }
+}
+
+inline std::size_t
+cow::shm_segment::recover()
+{
+  bool dead[kMaxProcesses] = {};
+  bool any = false;
+  for( std::size_t slot = 1; slot < kMaxProcesses; ++slot ) {
+    const std::int32_t pid = m_header->pids[slot].load(std::memory_order_acquire);
+    if( pid != 0 && _is_dead(pid) ) {
+      dead[slot] = any = true;
+    }
+  }
+  if( !any ) {
+    return 0;
+  }
+  std::size_t freed = 0;
+  _lock();
+  const std::uint64_t top = m_header->top;
+  _unlock();
+  for( std::uint64_t offset = (sizeof(header) + 63) & ~std::uint64_t(63); offset < top; ) {
+    block* b = _block(offset);
+    const std::uint64_t size = b->size;
+    if( b->state.load(std::memory_order_acquire) == block::kUsed ) {
+      for( std::size_t slot = 1; slot < kMaxProcesses; ++slot ) {
+        const std::uint32_t count = dead[slot] ? b->counts[slot].exchange(0, std::memory_order_relaxed) : 0;
+        if( count != 0 && _drop(offset, count) ) {
+          ++freed;
+        }
+      }
+    }
+    offset += size;
+  }
+  for( std::size_t slot = 1; slot < kMaxProcesses; ++slot ) {
+    if( dead[slot] ) {
+      const std::int32_t pid = m_header->pids[slot].load(std::memory_order_relaxed);
+      std::int32_t expected = pid;
+      m_header->pids[slot].compare_exchange_strong(expected, 0, std::memory_order_acq_rel);
+    }
+  }
+  return freed;
+}
+
+inline std::size_t
+cow::shm_segment::size() const
+{
+  return m_size;
+}
+
+inline std::size_t
+cow::shm_segment::used() const
+{
+  const_cast<shm_segment*>(this)->_lock();
+  const std::size_t used = static_cast<std::size_t>(m_header->used);
+  const_cast<shm_segment*>(this)->_unlock();
+  return used;
+}
+
+inline std::size_t
+cow::shm_segment::processes() const
+{
+  std::size_t count = 0;
+  for( std::size_t slot = 1; slot < kMaxProcesses; ++slot ) {
+    count += m_header->pids[slot].load(std::memory_order_relaxed) != 0;
+  }
+  return count;
+}
+
+inline void
+cow::shm_segment::_map(const char* name, int fd, std::size_t bytes)
+{
+  void* addr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  const int err = errno;
+  ::close(fd);
+  if( addr == MAP_FAILED ) {
+    throw std::system_error(err, std::generic_category(), name);
+  }
+  m_header = static_cast<header*>(addr);
+  m_size = bytes;
+}
+
+inline void
+cow::shm_segment::_attach()
+{
+  const std::int32_t pid = static_cast<std::int32_t>(::getpid());
+  for( int attempt = 0; attempt < 2; ++attempt ) {
+    for( std::size_t slot = 1; slot < kMaxProcesses; ++slot ) {
+      std::int32_t expected = 0;
+      if( m_header->pids[slot].compare_exchange_strong(expected, pid, std::memory_order_acq_rel) ) {
+        m_slot = slot;
+        return;
+      }
+    }
+    recover();
+  }
+  ::munmap(m_header, m_size);
+  throw std::system_error(EUSERS, std::generic_category(), "cow::shm_segment");
+}
+
+inline cow::shm_segment::block*
+cow::shm_segment::_block(std::uint64_t offset) const
+{
+  return reinterpret_cast<block*>(reinterpret_cast<char*>(m_header) + offset);
+}
+
+inline std::uint64_t
+cow::shm_segment::_allocate(std::size_t bytes)
+{
+  const std::uint64_t needed = (sizeof(block) + bytes + 63) & ~std::uint64_t(63);
+  std::size_t cls = 0;
+  while( (std::uint64_t(2) << cls) <= needed ) {
+    ++cls;
+  }
+  std::uint64_t offset = 0;
+  _lock();
+  // First fit in the class of 'needed', then any block of a larger class.
+  for( std::uint64_t* link = &m_header->free_lists[cls]; *link != 0; link = &_block(*link)->next ) {
+    if( _block(*link)->size >= needed ) {
+      offset = *link;
+      *link = _block(offset)->next;
+      break;
+    }
+  }
+  for( std::size_t c = cls + 1; offset == 0 && c < header::kClasses; ++c ) {
+    if( m_header->free_lists[c] != 0 ) {
+      offset = m_header->free_lists[c];
+      m_header->free_lists[c] = _block(offset)->next;
+    }
+  }
+  if( offset == 0 && needed <= m_header->size - m_header->top ) {
+    offset = m_header->top;
+    m_header->top += needed;
+    _block(offset)->size = needed;
+  }
+  if( offset != 0 ) {
+    m_header->used += _block(offset)->size;
+  }
+  _unlock();
+  if( offset == 0 ) {
+    throw std::bad_alloc();
+  }
+  block* b = _block(offset);
+  b->length = bytes;
+  b->next = 0;
+  b->total.store(1, std::memory_order_relaxed);
+  for( std::size_t slot = 0; slot < kMaxProcesses; ++slot ) {
+    b->counts[slot].store(slot == m_slot ? 1 : 0, std::memory_order_relaxed);
+  }
+  b->state.store(block::kUsed, std::memory_order_release);
+  return offset;
+}
+
+inline void
+cow::shm_segment::_acquire(std::uint64_t offset)
+{
+  _block(offset)->total.fetch_add(1, std::memory_order_relaxed);
+  _block(offset)->counts[m_slot].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void
+cow::shm_segment::_release(std::uint64_t offset)
+{
+  _release_slot(offset, m_slot);
+}
+
+inline void
+cow::shm_segment::_acquire_published(std::uint64_t offset)
+{
+  _block(offset)->total.fetch_add(1, std::memory_order_relaxed);
+  _block(offset)->counts[0].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void
+cow::shm_segment::_release_published(std::uint64_t offset)
+{
+  _release_slot(offset, 0);
+}
+
+inline void
+cow::shm_segment::_release_slot(std::uint64_t offset, std::size_t slot)
+{
+  _block(offset)->counts[slot].fetch_sub(1, std::memory_order_relaxed);
+  _drop(offset, 1);
+}
+
+// Takes 'count' references off the total, and frees the buffer if they were
+// the last ones. Returns whether it did.
+inline bool
+cow::shm_segment::_drop(std::uint64_t offset, std::uint32_t count)
+{
+  block* b = _block(offset);
+  if( b->total.fetch_sub(count, std::memory_order_acq_rel) != count ) {
+    return false;
+  }
+  b->state.store(block::kDead, std::memory_order_relaxed);
+  _free(offset);
+  return true;
+}
+
+inline long
+cow::shm_segment::_use_count(std::uint64_t offset) const
+{
+  return static_cast<long>(_block(offset)->total.load(std::memory_order_acquire));
+}
+
+inline void
+cow::shm_segment::_free(std::uint64_t offset)
+{
+  block* b = _block(offset);
+  std::size_t cls = 0;
+  while( (std::uint64_t(2) << cls) <= b->size ) {
+    ++cls;
+  }
+  _lock();
+  b->state.store(block::kFree, std::memory_order_relaxed);
+  b->next = m_header->free_lists[cls];
+  m_header->free_lists[cls] = offset;
+  m_header->used -= b->size;
+  _unlock();
+}
+
+inline void
+cow::shm_segment::_lock()
+{
+  const std::int32_t pid = static_cast<std::int32_t>(::getpid());
+  for( unsigned spins = 1; ; ++spins ) {
+    std::int32_t holder = 0;
+    if( m_header->lock.compare_exchange_weak(holder, pid, std::memory_order_acquire) ) {
+      return;
+    }
+    if( spins % 1024 == 0 ) {
+      // Take the lock over from a process that died holding it.
+      if( holder != 0 && _is_dead(holder) &&
+          m_header->lock.compare_exchange_strong(holder, pid, std::memory_order_acquire) ) {
+        return;
+      }
+      ::sched_yield();
+    }
+  }
+}
+
+inline void
+cow::shm_segment::_unlock()
+{
+  m_header->lock.store(0, std::memory_order_release);
+}
+
+inline bool
+cow::shm_segment::_is_dead(std::int32_t pid)
+{
+  return ::kill(static_cast<pid_t>(pid), 0) != 0 && errno == ESRCH;
+}
+
+
+//------------------------------------------------------------------------------
+// Implementation : basic_shm_string
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+cow::basic_shm_string<charT,traits,Alloc>::basic_shm_string(cow::shm_segment& segment)
+: m_segment(&segment)
+, m_offset(0)
+{
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_shm_string<charT,traits,Alloc>::basic_shm_string(
+  cow::shm_segment& segment,
+  const charT* s,
+  std::size_t n)
+: m_segment(&segment)
+, m_offset(0)
+{
+  if( n != 0 ) {
+    m_offset = segment._allocate((n + 1) * sizeof(charT));
+    charT* chars = reinterpret_cast<charT*>(segment._block(m_offset)->chars());
+    traits::copy(chars, s, n);
+    chars[n] = charT();
+    segment._block(m_offset)->length = n * sizeof(charT);
+  }
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_shm_string<charT,traits,Alloc>::basic_shm_string(
+  cow::shm_segment& segment,
+  const string_type& str)
+: basic_shm_string(segment, str.data(), str.size())
+{
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_shm_string<charT,traits,Alloc>::basic_shm_string(const basic_shm_string& str)
+: m_segment(str.m_segment)
+, m_offset(str.m_offset)
+{
+  if( m_offset != 0 ) {
+    m_segment->_acquire(m_offset);
+  }
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_shm_string<charT,traits,Alloc>::basic_shm_string(basic_shm_string&& str) noexcept
+: m_segment(str.m_segment)
+, m_offset(str.m_offset)
+{
+  str.m_offset = 0;
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_shm_string<charT,traits,Alloc>::~basic_shm_string()
+{
+  if( m_offset != 0 ) {
+    m_segment->_release(m_offset);
+  }
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_shm_string<charT,traits,Alloc>&
+cow::basic_shm_string<charT,traits,Alloc>::operator= (const basic_shm_string& str)
+{
+  basic_shm_string(str).swap(*this);
+  return *this;
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_shm_string<charT,traits,Alloc>&
+cow::basic_shm_string<charT,traits,Alloc>::operator= (basic_shm_string&& str) noexcept
+{
+  basic_shm_string(std::move(str)).swap(*this);
+  return *this;
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_shm_string<charT,traits,Alloc>::swap(basic_shm_string& str) noexcept
+{
+  std::swap(m_segment, str.m_segment);
+  std::swap(m_offset, str.m_offset);
+}
+
+template < class charT, class traits, class Alloc >
+std::uint64_t
+cow::basic_shm_string<charT,traits,Alloc>::publish() const
+{
+  if( m_offset != 0 ) {
+    m_segment->_acquire_published(m_offset);
+  }
+  return m_offset;
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_shm_string<charT,traits,Alloc>
+cow::basic_shm_string<charT,traits,Alloc>::attach(
+  cow::shm_segment& segment,
+  std::uint64_t offset,
+  bool adopt)
+{
+  basic_shm_string result(segment);
+  if( offset != 0 ) {
+    segment._acquire(offset);
+    result.m_offset = offset;
+    if( adopt ) {
+      segment._release_published(offset);
+    }
+  }
+  return result;
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_shm_string<charT,traits,Alloc>::unpublish(
+  cow::shm_segment& segment,
+  std::uint64_t offset)
+{
+  if( offset != 0 ) {
+    segment._release_published(offset);
+  }
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::size() const
+{
+  return m_offset == 0 ? 0 : m_segment->_block(m_offset)->length / sizeof(charT);
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::length() const
+{
+  return size();
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::basic_shm_string<charT,traits,Alloc>::empty() const
+{
+  return m_offset == 0;
+}
+
+template < class charT, class traits, class Alloc >
+const charT*
+cow::basic_shm_string<charT,traits,Alloc>::data() const
+{
+  static const charT empty = charT();
+  return m_offset == 0 ? &empty : reinterpret_cast<const charT*>(m_segment->_block(m_offset)->chars());
+}
+
+template < class charT, class traits, class Alloc >
+const charT*
+cow::basic_shm_string<charT,traits,Alloc>::c_str() const
+{
+  return data();
+}
+
+template < class charT, class traits, class Alloc >
+const charT&
+cow::basic_shm_string<charT,traits,Alloc>::operator[] (std::size_t pos) const
+{
+  return data()[pos];
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_shm_string<charT,traits,Alloc>::const_iterator
+cow::basic_shm_string<charT,traits,Alloc>::begin() const
+{
+  return data();
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_shm_string<charT,traits,Alloc>::const_iterator
+cow::basic_shm_string<charT,traits,Alloc>::end() const
+{
+  return data() + size();
+}
+
+template < class charT, class traits, class Alloc >
+charT&
+cow::basic_shm_string<charT,traits,Alloc>::operator[] (std::size_t pos)
+{
+  _detach();
+  return begin()[pos];
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_shm_string<charT,traits,Alloc>::iterator
+cow::basic_shm_string<charT,traits,Alloc>::begin()
+{
+  _detach();
+  return const_cast<charT*>(data());
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_shm_string<charT,traits,Alloc>::iterator
+cow::basic_shm_string<charT,traits,Alloc>::end()
+{
+  return begin() + size();
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::find(const basic_shm_string& str, std::size_t pos) const
+{
+  return string_type::_find(data(), size(), str.data(), pos, str.size());
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::find(const string_type& str, std::size_t pos) const
+{
+  return string_type::_find(data(), size(), str.data(), pos, str.size());
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::find(const charT* s, std::size_t pos) const
+{
+  return string_type::_find(data(), size(), s, pos, traits::length(s));
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::find(const charT* s, std::size_t pos, std::size_t n) const
+{
+  return string_type::_find(data(), size(), s, pos, n);
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::find(charT c, std::size_t pos) const
+{
+  return string_type::_find(data(), size(), &c, pos, 1);
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::rfind(const basic_shm_string& str, std::size_t pos) const
+{
+  return string_type::_rfind(data(), size(), str.data(), pos, str.size());
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::rfind(const string_type& str, std::size_t pos) const
+{
+  return string_type::_rfind(data(), size(), str.data(), pos, str.size());
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::rfind(const charT* s, std::size_t pos) const
+{
+  return string_type::_rfind(data(), size(), s, pos, traits::length(s));
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::rfind(const charT* s, std::size_t pos, std::size_t n) const
+{
+  return string_type::_rfind(data(), size(), s, pos, n);
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_shm_string<charT,traits,Alloc>::rfind(charT c, std::size_t pos) const
+{
+  return string_type::_rfind(data(), size(), &c, pos, 1);
+}
+
+template < class charT, class traits, class Alloc >
+int
+cow::basic_shm_string<charT,traits,Alloc>::compare(const basic_shm_string& str) const
+{
+  return string_type::_compare(data(), size(), str.data(), str.size());
+}
+
+template < class charT, class traits, class Alloc >
+int
+cow::basic_shm_string<charT,traits,Alloc>::compare(const string_type& str) const
+{
+  return string_type::_compare(data(), size(), str.data(), str.size());
+}
+
+template < class charT, class traits, class Alloc >
+int
+cow::basic_shm_string<charT,traits,Alloc>::compare(const charT* s) const
+{
+  return string_type::_compare(data(), size(), s, traits::length(s));
+}
+
+#if __cplusplus >= 201703L
+template < class charT, class traits, class Alloc >
+cow::basic_shm_string<charT,traits,Alloc>::operator std::basic_string_view<charT,traits>() const
+{
+  return std::basic_string_view<charT,traits>(data(), size());
+}
+#endif
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_shm_string<charT,traits,Alloc>::string_type
+cow::basic_shm_string<charT,traits,Alloc>::substr(std::size_t pos, std::size_t n) const
+{
+  if( pos > size() ) {
+    throw std::out_of_range("cow::basic_shm_string::substr");
+  }
+  if( n > size() - pos ) {
+    n = size() - pos;
+  }
+  return string_type(data() + pos, n);
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_shm_string<charT,traits,Alloc>::string_type
+cow::basic_shm_string<charT,traits,Alloc>::str() const
+{
+  return string_type(std::basic_string<charT,traits,Alloc>(data(), size()));
+}
+
+template < class charT, class traits, class Alloc >
+std::uint64_t
+cow::basic_shm_string<charT,traits,Alloc>::offset() const
+{
+  return m_offset;
+}
+
+template < class charT, class traits, class Alloc >
+long
+cow::basic_shm_string<charT,traits,Alloc>::use_count() const
+{
+  return m_offset == 0 ? 0 : m_segment->_use_count(m_offset);
+}
+
+template < class charT, class traits, class Alloc >
+cow::shm_segment&
+cow::basic_shm_string<charT,traits,Alloc>::segment() const
+{
+  return *m_segment;
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_shm_string<charT,traits,Alloc>::_detach()
+{
+  if( m_offset != 0 && m_segment->_use_count(m_offset) > 1 ) {
+    basic_shm_string(*m_segment, data(), size()).swap(*this);
+  }
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator== (const basic_shm_string<charT,traits,Alloc>& lhs, const basic_shm_string<charT,traits,Alloc>& rhs)
+{
+  return lhs.compare(rhs) == 0;
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator== (const basic_shm_string<charT,traits,Alloc>& lhs, const cow::basic_string<charT,traits,Alloc>& rhs)
+{
+  return lhs.compare(rhs) == 0;
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator== (const cow::basic_string<charT,traits,Alloc>& lhs, const basic_shm_string<charT,traits,Alloc>& rhs)
+{
+  return rhs.compare(lhs) == 0;
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator== (const basic_shm_string<charT,traits,Alloc>& lhs, const charT* rhs)
+{
+  return lhs.compare(rhs) == 0;
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator!= (const basic_shm_string<charT,traits,Alloc>& lhs, const basic_shm_string<charT,traits,Alloc>& rhs)
+{
+  return !(lhs == rhs);
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator!= (const basic_shm_string<charT,traits,Alloc>& lhs, const cow::basic_string<charT,traits,Alloc>& rhs)
+{
+  return !(lhs == rhs);
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator!= (const cow::basic_string<charT,traits,Alloc>& lhs, const basic_shm_string<charT,traits,Alloc>& rhs)
+{
+  return !(lhs == rhs);
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator!= (const basic_shm_string<charT,traits,Alloc>& lhs, const charT* rhs)
+{
+  return !(lhs == rhs);
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator< (const basic_shm_string<charT,traits,Alloc>& lhs, const basic_shm_string<charT,traits,Alloc>& rhs)
+{
+  return lhs.compare(rhs) < 0;
+}
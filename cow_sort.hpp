@@ -0,0 +1,441 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "cow_string.hpp"
+
+namespace cow {
+
+//------------------------------------------------------------------------------
+// Sort strings : cow::sort(..), cow::stable_sort(..)
+//------------------------------------------------------------------------------
+// Sort the cow::basic_string values of [first, last) like std::sort and
+// std::stable_sort do with operator<, by multikey quicksort: the strings are
+// partitioned on 8 bytes of their characters at a time (see _prefix_key),
+// starting with the keys their handles already hold, so characters are only
+// read past equal words. The handles are then moved into place; no
+// characters are copied.
+//
+// The parallel overloads first split large ranges into buckets on their
+// first 8 bytes, which 'threads' threads (the calling one and threads - 1
+// started for the call) then sort, each taking the next bucket when it is
+// done. Ranges under 16384 strings per thread use fewer threads. Strings of
+// the range mustn't be used by other threads meanwhile.
+//
+// Call them qualified: for iterators of std containers, std::sort is found
+// too.
+template < class RandomAccessIterator >
+void sort(RandomAccessIterator first, RandomAccessIterator last);
+template < class RandomAccessIterator >
+void sort(RandomAccessIterator first, RandomAccessIterator last, unsigned threads);
+template < class RandomAccessIterator >
+void stable_sort(RandomAccessIterator first, RandomAccessIterator last);
+template < class RandomAccessIterator >
+void stable_sort(RandomAccessIterator first, RandomAccessIterator last, unsigned threads);
+
+
+//------------------------------------------------------------------------------
+// Merge sorted runs : cow::merge(..)
+//------------------------------------------------------------------------------
+// Merges the sorted ranges 'runs' into 'out' and returns the end of the
+// output. The heads of the runs are kept in a heap ordered by operator<
+// (which compares the keys of shared handles first); equal strings are
+// written in the order of their runs. Strings are copied, which shares the
+// buffers of shared strings: pass std::move_iterator ranges to move them.
+template < class InputIterator, class OutputIterator >
+OutputIterator merge(const std::vector< std::pair<InputIterator,InputIterator> >& runs, OutputIterator out);
+
+
+struct _sort_access {
+  template < class String >
+  static std::uint64_t key(const String& str) { return str._get_prefix(); }
+};
+
+// A string being sorted: its characters, its position in the range, and the
+// key of its characters from the current depth on.
+template < class charT >
+struct _sort_entry {
+  std::uint64_t key;
+  const charT*  data;
+  std::size_t   size;
+  std::size_t   index;
+};
+
+// Sorts entries on their keys, a word of k characters at a time. At 'depth',
+// the entries' first 'depth' words are equal and their keys are those of the
+// next word.
+template < class charT, class traits >
+struct _string_sorter {
+  typedef cow::_sort_entry<charT> entry;
+  static const std::size_t k = 8 / sizeof(charT);
+
+  bool stable;  // order equal strings by index
+
+  // Words of characters past the first 'depth' ones.
+  static void rekey(entry* a, std::size_t n, std::size_t depth) {
+    const std::size_t skip = depth * k;
+    for( std::size_t i = 0; i < n; ++i ) {
+      a[i].key = a[i].size > skip ? cow::_prefix_key<charT,traits>(a[i].data + skip, a[i].size - skip) : 0;
+    }
+  }
+
+  bool less(const entry& a, const entry& b, std::size_t depth) const {
+    if( a.key != b.key ) {
+      return a.key < b.key;
+    }
+    // Equal keys: the characters they cover are equal, or are the padding of
+    // the shorter string.
+    const std::size_t skip = (depth + 1) * k;
+    const std::size_t n = std::min(a.size, b.size);
+    if( n > skip ) {
+      const int result = traits::compare(a.data + skip, b.data + skip, n - skip);
+      if( result != 0 ) {
+        return result < 0;
+      }
+    }
+    if( a.size != b.size ) {
+      return a.size < b.size;
+    }
+    return stable && a.index < b.index;
+  }
+
+  void insertion_sort(entry* a, std::size_t n, std::size_t depth) const {
+    for( std::size_t i = 1; i < n; ++i ) {
+      if( !less(a[i], a[i - 1], depth) ) {
+        continue;
+      }
+      const entry e = a[i];
+      std::size_t j = i;
+      do {
+        a[j] = a[j - 1];
+        --j;
+      } while( j != 0 && less(e, a[j - 1], depth) );
+      a[j] = e;
+    }
+  }
+
+  // Sorts the entries whose next word is equal: the ones that end within it
+  // go first, by size (and index), and the others are rekeyed on the word
+  // after. Returns how many ended.
+  std::size_t finish(entry* a, std::size_t n, std::size_t depth) const {
+    const std::size_t end = (depth + 1) * k;
+    entry* rest = std::partition(a, a + n, [end](const entry& e) { return e.size <= end; });
+    const bool by_index = stable;
+    std::sort(a, rest, [by_index](const entry& x, const entry& y) {
+      return x.size != y.size ? x.size < y.size : by_index && x.index < y.index;
+    });
+    rekey(rest, n - std::size_t(rest - a), depth + 1);
+    return std::size_t(rest - a);
+  }
+
+  // Sorts a[0, n), whose keys' first 'byte' bytes are equal. 'tmp' has room
+  // for n entries. Large ranges are distributed on the next byte of their
+  // keys (MSD radix sort), smaller ones are left to quicksort().
+  void sort(entry* a, entry* tmp, std::size_t n, std::size_t depth, unsigned byte = 0) const {
+    while( n >= 1024 ) {
+      const unsigned shift = 56 - 8 * byte;
+      std::size_t count[256] = { 0 };
+      for( std::size_t i = 0; i < n; ++i ) {
+        ++count[(a[i].key >> shift) & 0xFF];
+      }
+      std::size_t largest = 0;
+      for( std::size_t b = 1; b < 256; ++b ) {
+        if( count[b] > count[largest] ) {
+          largest = b;
+        }
+      }
+      if( count[largest] != n ) {
+        std::size_t start[256];
+        std::size_t offset = 0;
+        for( std::size_t b = 0; b < 256; ++b ) {
+          start[b] = offset;
+          offset += count[b];
+        }
+        for( std::size_t i = 0; i < n; ++i ) {
+          tmp[start[(a[i].key >> shift) & 0xFF]++] = a[i];
+        }
+        std::copy(tmp, tmp + n, a);
+        // Recurse on the buckets, but for the largest one, which is carried on
+        // with below.
+        for( std::size_t b = 0; b < 256; ++b ) {
+          if( b != largest && count[b] > 1 ) {
+            entry* bucket = a + start[b] - count[b];
+            if( byte < 7 ) {
+              sort(bucket, tmp, count[b], depth, byte + 1);
+            } else {
+              const std::size_t ended = finish(bucket, count[b], depth);
+              sort(bucket + ended, tmp, count[b] - ended, depth + 1);
+            }
+          }
+        }
+        a += start[largest] - count[largest];
+        n = count[largest];
+      }
+      if( byte < 7 ) {
+        ++byte;
+      } else {
+        // Equal keys: on to the next word.
+        const std::size_t ended = finish(a, n, depth);
+        a += ended;
+        n -= ended;
+        ++depth;
+        byte = 0;
+      }
+    }
+    quicksort(a, n, depth);
+  }
+
+  // Multikey quicksort, for small ranges: 3-way partitions on the keys.
+  void quicksort(entry* a, std::size_t n, std::size_t depth) const {
+    std::size_t budget = 0;  // partitions left before falling back to std::sort
+    for( std::size_t m = n; m != 0; m >>= 1 ) {
+      budget += 2;
+    }
+    while( n > 1 ) {
+      if( n <= 16 ) {
+        insertion_sort(a, n, depth);
+        return;
+      }
+      if( budget == 0 ) {
+        std::sort(a, a + n, [this, depth](const entry& x, const entry& y) { return less(x, y, depth); });
+        return;
+      }
+      --budget;
+      // Median of three keys.
+      std::uint64_t x = a[0].key, y = a[n / 2].key, z = a[n - 1].key;
+      if( x > y ) std::swap(x, y);
+      if( y > z ) std::swap(y, z);
+      if( x > y ) std::swap(x, y);
+      const std::uint64_t pivot = y;
+      std::size_t lt = 0, i = 0, gt = n;
+      while( i < gt ) {
+        if( a[i].key < pivot ) {
+          std::swap(a[lt++], a[i++]);
+        } else if( a[i].key > pivot ) {
+          std::swap(a[i], a[--gt]);
+        } else {
+          ++i;
+        }
+      }
+      // Recurse on the two smaller parts, and carry on with the largest.
+      const std::size_t below = lt, equal = gt - lt, above = n - gt;
+      if( equal >= below && equal >= above ) {
+        quicksort(a, below, depth);
+        quicksort(a + gt, above, depth);
+        const std::size_t ended = finish(a + lt, equal, depth);
+        a += lt + ended;
+        n = equal - ended;
+        ++depth;
+        budget = 0;
+        for( std::size_t m = n; m != 0; m >>= 1 ) {
+          budget += 2;
+        }
+      } else {
+        const std::size_t ended = finish(a + lt, equal, depth);
+        quicksort(a + lt + ended, equal - ended, depth + 1);
+        if( below >= above ) {
+          quicksort(a + gt, above, depth);
+          n = below;
+        } else {
+          quicksort(a, below, depth);
+          a += gt;
+          n = above;
+        }
+      }
+    }
+  }
+};
+
+// Sorts [first, last) with cow::_string_sorter, on 'threads' threads.
+template < class RandomAccessIterator >
+void _sort_strings(RandomAccessIterator first, RandomAccessIterator last, unsigned threads, bool stable) {
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type String;
+  typedef typename String::value_type  charT;
+  typedef typename String::traits_type traits;
+  typedef cow::_sort_entry<charT> entry;
+
+  const std::size_t n = std::size_t(last - first);
+  if( n < 2 ) {
+    return;
+  }
+  if( cow::_char_kernel_of<charT,traits>::value == cow::_kernel_traits ) {
+    // No keys for these traits.
+    if( stable ) {
+      std::stable_sort(first, last);
+    } else {
+      std::sort(first, last);
+    }
+    return;
+  }
+  std::vector<entry> entries(n);
+  for( std::size_t i = 0; i < n; ++i ) {
+    const String& s = first[i];
+    const entry e = { cow::_sort_access::key(s), s.data(), s.size(), i };
+    entries[i] = e;
+  }
+  cow::_string_sorter<charT,traits> sorter;
+  sorter.stable = stable;
+
+  if( threads > n / 16384 + 1 ) {
+    threads = static_cast<unsigned>(n / 16384 + 1);  // not worth it
+  }
+  if( threads <= 1 ) {
+    std::vector<entry> tmp(n);
+    sorter.sort(entries.data(), tmp.data(), n, 0);
+  } else {
+    // Splitters from a sample of the keys: bucket b gets the keys in
+    // (splitters[b-1], splitters[b]], so equal keys share a bucket.
+    const std::size_t buckets = std::size_t(threads) * 4;
+    std::vector<std::uint64_t> splitters;
+    for( std::size_t i = 0; i < buckets * 32; ++i ) {
+      splitters.push_back(entries[i * (n / (buckets * 32))].key);
+    }
+    std::sort(splitters.begin(), splitters.end());
+    for( std::size_t b = 1; b < buckets; ++b ) {
+      splitters[b - 1] = splitters[b * 32];
+    }
+    splitters.resize(buckets - 1);
+    splitters.erase(std::unique(splitters.begin(), splitters.end()), splitters.end());
+
+    std::vector<std::size_t> bucket_of(n);
+    std::vector<std::size_t> bounds(splitters.size() + 3, 0);  // bucket b is [bounds[b], bounds[b+1])
+    for( std::size_t i = 0; i < n; ++i ) {
+      bucket_of[i] = std::size_t(std::lower_bound(splitters.begin(), splitters.end(), entries[i].key) - splitters.begin());
+      ++bounds[bucket_of[i] + 2];
+    }
+    for( std::size_t b = 2; b < bounds.size(); ++b ) {
+      bounds[b] += bounds[b - 1];
+    }
+    std::vector<entry> distributed(n);
+    for( std::size_t i = 0; i < n; ++i ) {
+      distributed[bounds[bucket_of[i] + 1]++] = entries[i];
+    }
+    entries.swap(distributed);  // 'distributed' is now room for the buckets' radix sorts
+
+    // The calling thread sorts buckets too, alongside threads - 1 workers.
+    std::atomic<std::size_t> next(0);
+    const auto sort_buckets = [&]() {
+      for( std::size_t b = next++; b + 2 < bounds.size(); b = next++ ) {
+        sorter.sort(entries.data() + bounds[b], distributed.data() + bounds[b], bounds[b + 1] - bounds[b], 0);
+      }
+    };
+    std::vector<std::thread> workers;
+    for( unsigned t = 1; t < threads; ++t ) {
+      workers.push_back(std::thread(sort_buckets));
+    }
+    sort_buckets();
+    for( std::size_t t = 0; t < workers.size(); ++t ) {
+      workers[t].join();
+    }
+  }
+
+  std::vector<String> sorted;
+  sorted.reserve(n);
+  for( std::size_t i = 0; i < n; ++i ) {
+    sorted.push_back(std::move(first[entries[i].index]));
+  }
+  std::move(sorted.begin(), sorted.end(), first);
+}
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Implementation
+//------------------------------------------------------------------------------
+template < class RandomAccessIterator >
+void
+cow::sort(RandomAccessIterator first, RandomAccessIterator last)
+{
+  cow::_sort_strings(first, last, 1, false);
+}
+
+template < class RandomAccessIterator >
+void
+cow::sort(RandomAccessIterator first, RandomAccessIterator last, unsigned threads)
+{
+  cow::_sort_strings(first, last, threads, false);
+}
+
+template < class RandomAccessIterator >
+void
+cow::stable_sort(RandomAccessIterator first, RandomAccessIterator last)
+{
+  cow::_sort_strings(first, last, 1, true);
+}
+
+template < class RandomAccessIterator >
+void
+cow::stable_sort(RandomAccessIterator first, RandomAccessIterator last, unsigned threads)
+{
+  cow::_sort_strings(first, last, threads, true);
+}
+
+template < class InputIterator, class OutputIterator >
+OutputIterator
+cow::merge(const std::vector< std::pair<InputIterator,InputIterator> >& runs, OutputIterator out)
+{
+  std::vector<InputIterator> heads;
+  std::vector<std::size_t>   heap;  // indices of non-empty runs
+  for( std::size_t r = 0; r < runs.size(); ++r ) {
+    heads.push_back(runs[r].first);
+    if( runs[r].first != runs[r].second ) {
+      heap.push_back(r);
+    }
+  }
+  // Whether the head of run 'a' goes after the head of run 'b'.
+  const auto after = [&heads](std::size_t a, std::size_t b) {
+    if( *heads[b] < *heads[a] ) {
+      return true;
+    }
+    return a > b && !(*heads[a] < *heads[b]);
+  };
+  std::make_heap(heap.begin(), heap.end(), after);
+  while( heap.size() > 1 ) {
+    const std::size_t r = heap.front();
+    *out = *heads[r];
+    ++out;
+    if( ++heads[r] == runs[r].second ) {
+      std::pop_heap(heap.begin(), heap.end(), after);
+      heap.pop_back();
+      continue;
+    }
+    // Sift the run's new head down from the top.
+    std::size_t i = 0;
+    for( ;; ) {
+      const std::size_t left = 2 * i + 1;
+      if( left >= heap.size() ) {
+        break;
+      }
+      std::size_t child = left;
+      if( left + 1 < heap.size() && after(heap[left], heap[left + 1]) ) {
+        child = left + 1;
+      }
+      if( !after(heap[i], heap[child]) ) {
+        break;
+      }
+      std::swap(heap[i], heap[child]);
+      i = child;
+    }
+  }
+  if( !heap.empty() ) {
+    const std::size_t r = heap.front();
+    for( ; heads[r] != runs[r].second; ++heads[r] ) {
+      *out = *heads[r];
+      ++out;
+    }
+  }
+  return out;
+}
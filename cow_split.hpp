@@ -0,0 +1,562 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <ostream>
+#include <string>
+#include <utility>
+#if __cplusplus >= 201703L
+# include <string_view>
+#endif
+
+#include "cow_string.hpp"
+
+namespace cow {
+
+//----------------------------------------------------------------------------
+// Template declaration : Characters of a string, without a copy
+//----------------------------------------------------------------------------
+// A read-only view of characters owned by someone else (usually the string
+// being split). It is only valid while they are alive and unmodified. Unlike
+// cow::basic_string, a slice isn't NUL-terminated.
+template < class charT,
+           class traits = std::char_traits<charT>,
+           class Alloc = std::allocator<charT>
+           >
+class basic_slice
+{
+public:
+  typedef cow::basic_string<charT,traits,Alloc> string_type;
+  typedef charT                                 value_type;
+  typedef const charT*                          iterator;
+  typedef const charT*                          const_iterator;
+
+  basic_slice() : m_data(nullptr), m_size(0) {}
+  basic_slice(const charT* data, std::size_t size) : m_data(data), m_size(size) {}
+
+  const charT* data()   const { return m_data; }
+  std::size_t  size()   const { return m_size; }
+  std::size_t  length() const { return m_size; }
+  bool         empty()  const { return m_size == 0; }
+  const charT* begin()  const { return m_data; }
+  const charT* end()    const { return m_data + m_size; }
+  const charT& operator[] (std::size_t pos) const { return m_data[pos]; }
+
+  // Copy the characters into a cow string (one allocation).
+  string_type str() const { return string_type(m_data, m_size); }
+
+  int compare(const charT* s, std::size_t n) const;
+
+#if __cplusplus >= 201703L
+  operator std::basic_string_view<charT,traits>() const noexcept {
+    return std::basic_string_view<charT,traits>(m_data, m_size);
+  }
+#endif
+
+private:
+  const charT* m_data;
+  std::size_t  m_size;
+
+}; // template class basic_slice
+
+
+//----------------------------------------------------------------------------
+// Template declaration : Lazy range of slices : cow::split(..), cow::tokenize(..)
+//----------------------------------------------------------------------------
+// Finds the next slice only when the iterator is incremented: nothing is
+// allocated, and breaking out of a loop early doesn't scan the rest.
+//
+// The range refers to the string it splits, so that one must outlive it,
+// unless it was given as an rvalue: then the range keeps it alive itself.
+template < class charT,
+           class traits = std::char_traits<charT>,
+           class Alloc = std::allocator<charT>
+           >
+class basic_split_range
+{
+public:
+  typedef cow::basic_string<charT,traits,Alloc> string_type;
+  typedef cow::basic_slice<charT,traits,Alloc>  value_type;
+  class iterator;
+  typedef iterator                              const_iterator;
+
+  // 'tokenize' false: fields separated by the sequence [sep, sep+n).
+  // 'tokenize' true:  non-empty runs of characters not in [sep, sep+n).
+  basic_split_range(const string_type& str, const charT* sep, std::size_t n, bool tokenize);
+  basic_split_range(string_type&& str, const charT* sep, std::size_t n, bool tokenize);
+  basic_split_range(const basic_split_range& other);
+  basic_split_range(basic_split_range&& other);
+  basic_split_range& operator= (const basic_split_range&) = delete;
+
+  iterator begin() const;
+  iterator end()   const;
+
+private:
+  const charT* _next_sep(const charT* first) const;
+  bool         _is_sep(charT c) const;
+
+  string_type                           m_owned;  // an rvalue being split
+  const charT*                          m_data;
+  std::size_t                           m_size;
+  std::basic_string<charT,traits,Alloc> m_sep;
+  bool                                  m_tokenize;
+
+}; // template class basic_split_range
+
+template < class charT, class traits, class Alloc >
+class basic_split_range<charT,traits,Alloc>::iterator
+{
+public:
+  typedef std::input_iterator_tag                    iterator_category;
+  typedef cow::basic_slice<charT,traits,Alloc>       value_type;
+  typedef std::ptrdiff_t                             difference_type;
+  typedef const value_type*                          pointer;
+  typedef const value_type&                          reference;
+
+  iterator() : m_range(nullptr), m_slice(), m_last(true) {}
+
+  reference  operator*  () const { return m_slice; }
+  pointer    operator-> () const { return &m_slice; }
+  iterator&  operator++ ();
+  iterator   operator++ (int) { iterator copy(*this); ++*this; return copy; }
+
+  bool operator== (const iterator& rhs) const { return m_slice.data() == rhs.m_slice.data(); }
+  bool operator!= (const iterator& rhs) const { return !(*this == rhs); }
+
+private:
+  friend class basic_split_range<charT,traits,Alloc>;
+  iterator(const basic_split_range* range, const charT* first);
+  void _find(const charT* first);
+
+  const basic_split_range* m_range;
+  value_type               m_slice;  // data() is null at the end
+  bool                     m_last;   // no separator after m_slice
+};
+
+
+//------------------------------------------------------------------------------
+// Split a string : cow::split(..)
+//------------------------------------------------------------------------------
+// Fields separated by 'sep' (a character or a sequence of characters). Empty
+// fields are kept: a string with N separators has N+1 fields.
+template < class charT, class traits, class Alloc >
+basic_split_range<charT,traits,Alloc> split(const cow::basic_string<charT,traits,Alloc>& str, charT sep);
+template < class charT, class traits, class Alloc >
+basic_split_range<charT,traits,Alloc> split(const cow::basic_string<charT,traits,Alloc>& str, const charT* sep);
+template < class charT, class traits, class Alloc >
+basic_split_range<charT,traits,Alloc> split(const cow::basic_string<charT,traits,Alloc>& str, const cow::basic_string<charT,traits,Alloc>& sep);
+template < class charT, class traits, class Alloc >
+basic_split_range<charT,traits,Alloc> split(cow::basic_string<charT,traits,Alloc>&& str, charT sep);
+template < class charT, class traits, class Alloc >
+basic_split_range<charT,traits,Alloc> split(cow::basic_string<charT,traits,Alloc>&& str, const charT* sep);
+template < class charT, class traits, class Alloc >
+basic_split_range<charT,traits,Alloc> split(cow::basic_string<charT,traits,Alloc>&& str, const cow::basic_string<charT,traits,Alloc>& sep);
+
+
+//------------------------------------------------------------------------------
+// Split a string into tokens : cow::tokenize(..)
+//------------------------------------------------------------------------------
+// Non-empty runs of characters that aren't in 'delims' (like strtok).
+template < class charT, class traits, class Alloc >
+basic_split_range<charT,traits,Alloc> tokenize(const cow::basic_string<charT,traits,Alloc>& str, const charT* delims);
+template < class charT, class traits, class Alloc >
+basic_split_range<charT,traits,Alloc> tokenize(const cow::basic_string<charT,traits,Alloc>& str, const cow::basic_string<charT,traits,Alloc>& delims);
+template < class charT, class traits, class Alloc >
+basic_split_range<charT,traits,Alloc> tokenize(cow::basic_string<charT,traits,Alloc>&& str, const charT* delims);
+template < class charT, class traits, class Alloc >
+basic_split_range<charT,traits,Alloc> tokenize(cow::basic_string<charT,traits,Alloc>&& str, const cow::basic_string<charT,traits,Alloc>& delims);
+
+
+//------------------------------------------------------------------------------
+// Join strings : cow::join(..)
+//------------------------------------------------------------------------------
+// Concatenates [first, last) with 'sep' in between, into one allocation.
+// The elements can be anything with data() and size(): cow or std strings,
+// slices, string views.
+template < class ForwardIterator, class charT >
+cow::basic_string<charT> join(ForwardIterator first, ForwardIterator last, const charT* sep);
+template < class ForwardIterator, class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> join(ForwardIterator first, ForwardIterator last, const cow::basic_string<charT,traits,Alloc>& sep);
+template < class Range, class charT >
+cow::basic_string<charT> join(const Range& range, const charT* sep);
+template < class Range, class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> join(const Range& range, const cow::basic_string<charT,traits,Alloc>& sep);
+
+template < class charT, class traits, class Alloc, class ForwardIterator >
+cow::basic_string<charT,traits,Alloc> _join(ForwardIterator first, ForwardIterator last, const charT* sep, std::size_t n);
+
+
+//------------------------------------------------------------------------------
+// Compare and output slices
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+bool operator== (const basic_slice<charT,traits,Alloc>& lhs, const basic_slice<charT,traits,Alloc>& rhs);
+template < class charT, class traits, class Alloc >
+bool operator== (const basic_slice<charT,traits,Alloc>& lhs, const charT* rhs);
+template < class charT, class traits, class Alloc >
+bool operator== (const charT* lhs, const basic_slice<charT,traits,Alloc>& rhs);
+template < class charT, class traits, class Alloc >
+bool operator== (const basic_slice<charT,traits,Alloc>& lhs, const cow::basic_string<charT,traits,Alloc>& rhs);
+template < class charT, class traits, class Alloc >
+bool operator== (const cow::basic_string<charT,traits,Alloc>& lhs, const basic_slice<charT,traits,Alloc>& rhs);
+template < class charT, class traits, class Alloc, class T >
+bool operator!= (const basic_slice<charT,traits,Alloc>& lhs, const T& rhs) { return !(lhs == rhs); }
+
+template < class charT, class traits, class Alloc >
+std::basic_ostream<charT,traits>& operator<< (std::basic_ostream<charT,traits>& os, const basic_slice<charT,traits,Alloc>& slice);
+
+
+//------------------------------------------------------------------------------
+// Class instantiations
+//------------------------------------------------------------------------------
+typedef cow::basic_slice<char>            slice;
+typedef cow::basic_slice<char16_t>        u16slice;
+typedef cow::basic_slice<char32_t>        u32slice;
+typedef cow::basic_slice<wchar_t>         wslice;
+
+typedef cow::basic_split_range<char>      split_range;
+typedef cow::basic_split_range<char16_t>  u16split_range;
+typedef cow::basic_split_range<char32_t>  u32split_range;
+typedef cow::basic_split_range<wchar_t>   wsplit_range;
+
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Implementation : cow::basic_slice
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+int
+cow::basic_slice<charT,traits,Alloc>::compare(const charT* s, std::size_t n) const
+{
+  const int r = traits::compare(m_data, s, m_size < n ? m_size : n);
+  if( r != 0 ) {
+    return r;
+  }
+  return m_size < n ? -1 : m_size > n ? 1 : 0;
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator== (const basic_slice<charT,traits,Alloc>& lhs, const basic_slice<charT,traits,Alloc>& rhs)
+{
+  return lhs.size() == rhs.size() && lhs.compare(rhs.data(), rhs.size()) == 0;
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator== (const basic_slice<charT,traits,Alloc>& lhs, const charT* rhs)
+{
+  return lhs.compare(rhs, traits::length(rhs)) == 0;
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator== (const charT* lhs, const basic_slice<charT,traits,Alloc>& rhs)
+{
+  return rhs == lhs;
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator== (const basic_slice<charT,traits,Alloc>& lhs, const cow::basic_string<charT,traits,Alloc>& rhs)
+{
+  return lhs.size() == rhs.size() && lhs.compare(rhs.data(), rhs.size()) == 0;
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::operator== (const cow::basic_string<charT,traits,Alloc>& lhs, const basic_slice<charT,traits,Alloc>& rhs)
+{
+  return rhs == lhs;
+}
+
+template < class charT, class traits, class Alloc >
+std::basic_ostream<charT,traits>&
+cow::operator<< (std::basic_ostream<charT,traits>& os, const basic_slice<charT,traits,Alloc>& slice)
+{
+  return os.write(slice.data(), static_cast<std::streamsize>(slice.size()));
+}
+
+
+//------------------------------------------------------------------------------
+// Implementation : cow::basic_split_range
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>::basic_split_range(
+  const string_type& str,
+  const charT* sep,
+  std::size_t n,
+  bool tokenize)
+: m_owned()
+, m_data(str.data())
+, m_size(str.size())
+, m_sep(sep, n)
+, m_tokenize(tokenize)
+{
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>::basic_split_range(
+  string_type&& str,
+  const charT* sep,
+  std::size_t n,
+  bool tokenize)
+: m_owned(std::move(str))
+, m_data(m_owned.data())
+, m_size(m_owned.size())
+, m_sep(sep, n)
+, m_tokenize(tokenize)
+{
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>::basic_split_range(const basic_split_range& other)
+: m_owned(other.m_owned)
+, m_data(other.m_data == other.m_owned.data() ? m_owned.data() : other.m_data)
+, m_size(other.m_size)
+, m_sep(other.m_sep)
+, m_tokenize(other.m_tokenize)
+{
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>::basic_split_range(basic_split_range&& other)
+// Moving a cow::basic_string doesn't move its characters.
+: m_owned(std::move(other.m_owned))
+, m_data(other.m_data)
+, m_size(other.m_size)
+, m_sep(std::move(other.m_sep))
+, m_tokenize(other.m_tokenize)
+{
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_split_range<charT,traits,Alloc>::iterator
+cow::basic_split_range<charT,traits,Alloc>::begin() const
+{
+  return iterator(this, m_data);
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_split_range<charT,traits,Alloc>::iterator
+cow::basic_split_range<charT,traits,Alloc>::end() const
+{
+  return iterator();
+}
+
+template < class charT, class traits, class Alloc >
+bool
+cow::basic_split_range<charT,traits,Alloc>::_is_sep(charT c) const
+{
+  return traits::find(m_sep.data(), m_sep.size(), c) != nullptr;
+}
+
+template < class charT, class traits, class Alloc >
+const charT*
+cow::basic_split_range<charT,traits,Alloc>::_next_sep(const charT* first) const
+{
+  const charT* const last = m_data + m_size;
+  if( m_tokenize ) {
+    while( first != last && !_is_sep(*first) ) {
+      ++first;
+    }
+    return first;
+  }
+  const std::size_t n = m_sep.size();
+  if( n == 0 ) {
+    return last;
+  }
+  while( static_cast<std::size_t>(last - first) >= n ) {
+    const charT* p = traits::find(first, static_cast<std::size_t>(last - first) - n + 1, m_sep[0]);
+    if( p == nullptr ) {
+      break;
+    }
+    if( traits::compare(p + 1, m_sep.data() + 1, n - 1) == 0 ) {
+      return p;
+    }
+    first = p + 1;
+  }
+  return last;
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>::iterator::iterator(
+  const basic_split_range* range,
+  const charT* first)
+: m_range(range)
+, m_slice()
+, m_last(false)
+{
+  _find(first);
+}
+
+template < class charT, class traits, class Alloc >
+typename cow::basic_split_range<charT,traits,Alloc>::iterator&
+cow::basic_split_range<charT,traits,Alloc>::iterator::operator++ ()
+{
+  if( m_last ) {
+    m_slice = value_type();
+  } else {
+    _find(m_slice.end() + (m_range->m_tokenize ? 1 : m_range->m_sep.size()));
+  }
+  return *this;
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_split_range<charT,traits,Alloc>::iterator::_find(const charT* first)
+{
+  const charT* const last = m_range->m_data + m_range->m_size;
+  if( m_range->m_tokenize ) {
+    while( first != last && m_range->_is_sep(*first) ) {
+      ++first;
+    }
+    if( first == last ) {
+      m_slice = value_type();
+      m_last = true;
+      return;
+    }
+  }
+  const charT* end = m_range->_next_sep(first);
+  m_slice = value_type(first, static_cast<std::size_t>(end - first));
+  m_last = end == last;
+}
+
+
+//------------------------------------------------------------------------------
+// Implementation : cow::split(..), cow::tokenize(..)
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>
+cow::split(const cow::basic_string<charT,traits,Alloc>& str, charT sep)
+{
+  return cow::basic_split_range<charT,traits,Alloc>(str, &sep, 1, false);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>
+cow::split(const cow::basic_string<charT,traits,Alloc>& str, const charT* sep)
+{
+  return cow::basic_split_range<charT,traits,Alloc>(str, sep, traits::length(sep), false);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>
+cow::split(const cow::basic_string<charT,traits,Alloc>& str, const cow::basic_string<charT,traits,Alloc>& sep)
+{
+  return cow::basic_split_range<charT,traits,Alloc>(str, sep.data(), sep.size(), false);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>
+cow::split(cow::basic_string<charT,traits,Alloc>&& str, charT sep)
+{
+  return cow::basic_split_range<charT,traits,Alloc>(std::move(str), &sep, 1, false);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>
+cow::split(cow::basic_string<charT,traits,Alloc>&& str, const charT* sep)
+{
+  return cow::basic_split_range<charT,traits,Alloc>(std::move(str), sep, traits::length(sep), false);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>
+cow::split(cow::basic_string<charT,traits,Alloc>&& str, const cow::basic_string<charT,traits,Alloc>& sep)
+{
+  return cow::basic_split_range<charT,traits,Alloc>(std::move(str), sep.data(), sep.size(), false);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>
+cow::tokenize(const cow::basic_string<charT,traits,Alloc>& str, const charT* delims)
+{
+  return cow::basic_split_range<charT,traits,Alloc>(str, delims, traits::length(delims), true);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>
+cow::tokenize(const cow::basic_string<charT,traits,Alloc>& str, const cow::basic_string<charT,traits,Alloc>& delims)
+{
+  return cow::basic_split_range<charT,traits,Alloc>(str, delims.data(), delims.size(), true);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>
+cow::tokenize(cow::basic_string<charT,traits,Alloc>&& str, const charT* delims)
+{
+  return cow::basic_split_range<charT,traits,Alloc>(std::move(str), delims, traits::length(delims), true);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_split_range<charT,traits,Alloc>
+cow::tokenize(cow::basic_string<charT,traits,Alloc>&& str, const cow::basic_string<charT,traits,Alloc>& delims)
+{
+  return cow::basic_split_range<charT,traits,Alloc>(std::move(str), delims.data(), delims.size(), true);
+}
+
+
+//------------------------------------------------------------------------------
+// Implementation : cow::join(..)
+//------------------------------------------------------------------------------
+template < class ForwardIterator, class charT >
+cow::basic_string<charT>
+cow::join(ForwardIterator first, ForwardIterator last, const charT* sep)
+{
+  typedef std::char_traits<charT> traits;
+  return cow::_join<charT, traits, std::allocator<charT> >(first, last, sep, traits::length(sep));
+}
+
+template < class ForwardIterator, class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::join(ForwardIterator first, ForwardIterator last, const cow::basic_string<charT,traits,Alloc>& sep)
+{
+  return cow::_join<charT,traits,Alloc>(first, last, sep.data(), sep.size());
+}
+
+template < class Range, class charT >
+cow::basic_string<charT>
+cow::join(const Range& range, const charT* sep)
+{
+  using std::begin;
+  using std::end;
+  return cow::join(begin(range), end(range), sep);
+}
+
+template < class Range, class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::join(const Range& range, const cow::basic_string<charT,traits,Alloc>& sep)
+{
+  using std::begin;
+  using std::end;
+  return cow::join(begin(range), end(range), sep);
+}
+
+template < class charT, class traits, class Alloc, class ForwardIterator >
+cow::basic_string<charT,traits,Alloc>
+cow::_join(ForwardIterator first, ForwardIterator last, const charT* sep, std::size_t n)
+{
+  if( first == last ) {
+    return cow::basic_string<charT,traits,Alloc>();
+  }
+  std::size_t size = 0;
+  for( ForwardIterator it = first; it != last; ++it ) {
+    size += it->size() + n;
+  }
+  std::basic_string<charT,traits,Alloc> result;
+  result.reserve(size - n);
+  result.append(first->data(), first->size());
+  for( ++first; first != last; ++first ) {
+    result.append(sep, n);
+    result.append(first->data(), first->size());
+  }
+  return cow::basic_string<charT,traits,Alloc>(std::move(result));
+}
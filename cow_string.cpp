@@ -0,0 +1,13 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+// Explicit instantiations of the cow_string_impl library.
+
+#include "cow_string.hpp"
+
+COWSTRING_INSTANTIATE(template, char)
+COWSTRING_INSTANTIATE(template, char16_t)
+COWSTRING_INSTANTIATE(template, char32_t)
+COWSTRING_INSTANTIATE(template, wchar_t)
@@ -5,745 +5,42 @@
 
 #pragma once
 
-#include <string>
-#include <memory>
-#include <ostream> //TODO testing: remove this
+#include <cerrno>
+#include <cstdio>
+#include <istream>
+#include <ostream>
+#include <system_error>
+#include <vector>
 
-namespace cow {
-
-//----------------------------------------------------------------------------
-// Template declaration : Copy-On-Write (COW) Basic String
-//----------------------------------------------------------------------------
-template < class charT,
-           class traits = std::char_traits<charT>,    // std::basic_string::traits_type
-           class Alloc = std::allocator<charT>        // std::basic_string::allocator_type
-           >
-class basic_string
-{
-public:
-  static const std::size_t npos = std::basic_string<charT,traits,Alloc>::npos;
-
-  typedef std::string::size_type                size_type;
-  typedef std::string::iterator                 iterator;
-  typedef std::string::const_iterator           const_iterator;
-  typedef std::string::reverse_iterator         reverse_iterator;
-  typedef std::string::const_reverse_iterator   const_reverse_iterator;
-
-
-  //----------------------------------------------------------------------------
-  // Construct string object
-  //----------------------------------------------------------------------------
-  // default (1)
-  basic_string ();
-  // copy (2)
-  basic_string (const cow::basic_string<charT,traits,Alloc>& str);
-  // copy (2.1)
-#if !defined(COWSTRING_IMPLICIT_STDSTRING_CTORS) && __cplusplus >= 201103L
-  explicit
-#endif
-  basic_string (const std::basic_string<charT,traits,Alloc>& str);
-  // substring (3)
-  basic_string (const cow::basic_string<charT,traits,Alloc>& str, std::size_t pos, std::size_t len = npos);
-  basic_string (const std::basic_string<charT,traits,Alloc>& str, std::size_t pos, std::size_t len = npos);
-  // from c-string (4)
-  basic_string (const char* nul_terminated_c_str);
-  // from buffer (5)
-  basic_string (const char* s, std::size_t n);
-  // fill (6)
-  basic_string (std::size_t n, char c);
-  // range (7)
-  template <class InputIterator>
-  basic_string (InputIterator first, InputIterator last);
-#if __cplusplus >= 201103L
-  // initializer list (8)
-  basic_string (std::initializer_list<char> il);
-  // move (9)
-  basic_string (cow::basic_string<charT,traits,Alloc>&& str);
-  // move (9.1)
-# if !defined(COWSTRING_IMPLICIT_STDSTRING_CTORS) && __cplusplus >= 201103L
-  explicit
-# endif
-  basic_string (std::basic_string<charT,traits,Alloc>&& str);
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // String destructor
-  //----------------------------------------------------------------------------
-  ~basic_string();
-
-
-  //----------------------------------------------------------------------------
-  // String assignment : cow::string::operator=
-  //----------------------------------------------------------------------------
-  // string (1)
-  cow::basic_string<charT,traits,Alloc>& operator= (const std::basic_string<charT,traits,Alloc>& str);
-  // cow::string (1.1)
-  cow::basic_string<charT,traits,Alloc>& operator= (const cow::basic_string<charT,traits,Alloc>& str);
-  // c-string (2)
-  cow::basic_string<charT,traits,Alloc>& operator= (const char* s);
-  // character (3)
-  cow::basic_string<charT,traits,Alloc>& operator= (char c);
-#if __cplusplus >= 201103L
-  // initializer list (4)
-  cow::basic_string<charT,traits,Alloc>& operator= (std::initializer_list<char> il);
-  // move (5)
-  cow::basic_string<charT,traits,Alloc>& operator= (std::basic_string<charT,traits,Alloc>&& str) noexcept;
-  // move (5.1)
-  cow::basic_string<charT,traits,Alloc>& operator= (cow::basic_string<charT,traits,Alloc>&& str) noexcept;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Return iterator to beginning : cow::string::begin(..)
-  //----------------------------------------------------------------------------
-#if __cplusplus >= 201103L
-        iterator begin() noexcept;
-  const_iterator begin() const noexcept;
-#else
-        iterator begin();
-  const_iterator begin() const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Return iterator to end : cow::string::end(..)
-  //----------------------------------------------------------------------------
-#if __cplusplus >= 201103L
-        iterator end() noexcept;
-  const_iterator end() const noexcept;
-#else
-        iterator end();
-  const_iterator end() const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Return reverse iterator to reverse beginning : cow::string::rbegin(..)
-  //----------------------------------------------------------------------------
-#if __cplusplus >= 201103L
-        reverse_iterator rbegin() noexcept;
-  const_reverse_iterator rbegin() const noexcept;
-#else
-        reverse_iterator rbegin();
-  const_reverse_iterator rbegin() const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Return reverse iterator to reverse end : cow::string::rend(..)
-  //----------------------------------------------------------------------------
-#if __cplusplus >= 201103L
-        reverse_iterator rend() noexcept;
-  const_reverse_iterator rend() const noexcept;
-#else
-        reverse_iterator rend();
-  const_reverse_iterator rend() const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // C++11 explicit const_iterator functions.
-  //----------------------------------------------------------------------------
-#if __cplusplus >= 201103L
-  const_iterator         cbegin()  const noexcept;
-  const_iterator         cend()    const noexcept;
-  const_reverse_iterator crbegin() const noexcept;
-  const_reverse_iterator crend()   const noexcept;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Return length of string
-  //----------------------------------------------------------------------------
-#if __cplusplus >= 201103L
-  std::size_t size() const noexcept;
-  std::size_t length() const noexcept;
-  std::size_t max_size() const noexcept;
-  std::size_t capacity() const noexcept;
-  bool        empty() const noexcept;
-#else
-  std::size_t size() const;
-  std::size_t length() const;
-  std::size_t max_size() const;
-  std::size_t capacity() const;
-  bool        empty() const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Change string size
-  //----------------------------------------------------------------------------
-  void resize(std::size_t n);
-  void resize(std::size_t n, char c);
-  void reserve(std::size_t n = 0);
-#if __cplusplus >= 201103L
-  void clear() noexcept;
-  void shrink_to_fit();
-#else
-  void clear();
-#endif
-
-  //----------------------------------------------------------------------------
-  // Get character of string
-  //----------------------------------------------------------------------------
-  // TODO(olegat) should return a class that override write-operators.
-        charT& operator[] (std::size_t pos);
-  const charT& operator[] (std::size_t pos) const;
-        charT& at (std::size_t pos);
-  const charT& at (std::size_t pos) const;
-#if __cplusplus >= 201103L
-        charT& back ();
-  const charT& back () const;
-        charT& front();
-  const charT& front() const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Append to string : cow::string::operator+=
-  //----------------------------------------------------------------------------
-  // string (1)
-  cow::basic_string<charT,traits,Alloc>& operator+= (const cow::basic_string<charT,traits,Alloc>& str);
-  cow::basic_string<charT,traits,Alloc>& operator+= (const std::basic_string<charT,traits,Alloc>& str);
-  // c-string (2)
-  cow::basic_string<charT,traits,Alloc>& operator+= (const charT* s);
-  // character (3)
-  cow::basic_string<charT,traits,Alloc>& operator+= (charT c);
-#if __cplusplus >= 201103L
-  // initializer list (4)
-  cow::basic_string<charT,traits,Alloc>& operator+= (std::initializer_list<charT> il);
-#endif
-
-  // string (1)
-  cow::basic_string<charT,traits,Alloc>& append (const cow::basic_string<charT,traits,Alloc>& str);
-  // substring (2)
-  cow::basic_string<charT,traits,Alloc>& append (const cow::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen);
-  // c-string (3)
-  cow::basic_string<charT,traits,Alloc>& append (const charT* s);
-  // buffer (4)
-  cow::basic_string<charT,traits,Alloc>& append (const charT* s, std::size_t n);
-  // fill (5)
-  cow::basic_string<charT,traits,Alloc>& append (std::size_t n, charT c);
-  // range (6)
-  template <class InputIterator>
-  cow::basic_string<charT,traits,Alloc>& append (InputIterator first, InputIterator last);
-#if __cplusplus >= 201103L
-  // initializer list(7)
-  cow::basic_string<charT,traits,Alloc>& append (std::initializer_list<charT> il);
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Modifiers
-  //----------------------------------------------------------------------------
-  void push_back(charT c);
-  void swap(cow::basic_string<charT,traits,Alloc>& str);
-  void swap(std::basic_string<charT,traits,Alloc>& str);
-#if __cplusplus >= 201103L
-  void pop_back();
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Assign content to string : cow::string::assign(..)
-  //----------------------------------------------------------------------------
-  // string (1)
-  cow::basic_string<charT,traits,Alloc>& assign (const cow::basic_string<charT,traits,Alloc>& str);
-  // substring (2)
-  cow::basic_string<charT,traits,Alloc>& assign (const cow::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen = npos);
-  // c-string (3)
-  cow::basic_string<charT,traits,Alloc>& assign (const charT* s);
-  // buffer (4)
-  cow::basic_string<charT,traits,Alloc>& assign (const charT* s, std::size_t n);
-  // fill (5)
-  cow::basic_string<charT,traits,Alloc>& assign (std::size_t n, charT c);
-  // range (6)
-  template <class InputIterator>
-  cow::basic_string<charT,traits,Alloc>& assign (InputIterator first, InputIterator last);
-#if __cplusplus >= 201103L
-  // initializer list(7)
-  cow::basic_string<charT,traits,Alloc>& assign (std::initializer_list<charT> il);
-  // move (8)
-  cow::basic_string<charT,traits,Alloc>& assign (cow::basic_string<charT,traits,Alloc>&& str) noexcept;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Insert into string : cow::string::insert(..)
-  //----------------------------------------------------------------------------
-  // string (1)
-  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const std::basic_string<charT,traits,Alloc>& str);
-  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const cow::basic_string<charT,traits,Alloc>& str);
-  // substring (2)
-#if __cplusplus >= 201402L
-  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const std::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen = npos);
-  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const cow::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen = npos);
-#endif
-  // c-string (3)
-  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const charT* s);
-  // buffer (4)
-  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const charT* s, std::size_t n);
-  // fill (5)
-  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos,   std::size_t n, charT c);
-  iterator                               insert (const_iterator p, std::size_t n, charT c);
-  // single character (6)
-  iterator                               insert (const_iterator p, charT c);
-#if __cplusplus >= 201103L
-  // range (7)
-  template <class InputIterator>
-  iterator                               insert (iterator p, InputIterator first, InputIterator last);
-  // initializer list (8)
-  cow::basic_string<charT,traits,Alloc>& insert (const_iterator p, std::initializer_list<charT> il);
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Erase characters from string : cow::string::erase(..)
-  //----------------------------------------------------------------------------
-  // sequence (1)
-#if __cplusplus >= 201402L
-  cow::basic_string<charT,traits,Alloc>& erase (std::size_t pos = 0, std::size_t len = npos);
-#endif
-#if __cplusplus >= 201103L
-  // character (2)
-  iterator erase (const_iterator p);
-  // range (3)
-  iterator erase (const_iterator first, const_iterator last);
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Replace portion of string : cow::string::replace(..)
-  //----------------------------------------------------------------------------
-  // string (1)
-  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const std::basic_string<charT,traits,Alloc>& str);
-  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const cow::basic_string<charT,traits,Alloc>& str);
-  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, const std::basic_string<charT,traits,Alloc>& str);
-  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, const cow::basic_string<charT,traits,Alloc>& str);
-  // substring (2)
-#if __cplusplus >= 201402L
-  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const std::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen = npos);
-  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const cow::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen = npos);
-#else
-  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const std::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen);
-  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const cow::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen);
-#endif
-  // c-string (3)
-  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const charT* s);
-  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, const charT* s);
-  // buffer (4)
-  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const charT* s, std::size_t n);
-  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, const charT* s, std::size_t n);
-  // fill (5)
-  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   std::size_t n, charT c);
-  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, std::size_t n, charT c);
-  // range (6)
-  template <class InputIterator>
-  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, InputIterator first, InputIterator last);
-#if __cplusplus >= 201103L
-  // initializer list (7)
-  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, std::initializer_list<charT> il);
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Get C-string equivalent : cow::string::c_str()
-  //----------------------------------------------------------------------------
-#if __cplusplus >= 201103L
-  const charT* c_str() const noexcept;
-  const charT* data()  const noexcept;
-  Alloc get_allocator() const noexcept;
-#else
-  const charT* c_str() const;
-  const charT* data()  const;
-  Alloc get_allocator() const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Copy sequence of characters from string : cow::string::copy(..)
-  //----------------------------------------------------------------------------
-  size_type copy(charT* s, size_type len, size_type pos = 0) const;
-
-
-  //----------------------------------------------------------------------------
-  // Find content in string : cow::string::find(..)
-  //----------------------------------------------------------------------------
-  // string (1)
-#if __cplusplus >= 201103L
-  std::size_t find (const std::basic_string<charT,traits,Alloc>& str, std::size_t pos = 0) const noexcept;
-  std::size_t find (const cow::basic_string<charT,traits,Alloc>& str, std::size_t pos = 0) const noexcept;
-#else
-  std::size_t find (const std::basic_string<charT,traits,Alloc>& str, std::size_t pos = 0) const;
-  std::size_t find (const cow::basic_string<charT,traits,Alloc>& str, std::size_t pos = 0) const;
-#endif
-  // c-string (2)
-  std::size_t find (const charT* s, std::size_t pos = 0) const;
-  // buffer (3)
-  std::size_t find (const charT* s, std::size_t pos, size_type n) const;
-  // character (4)
-#if __cplusplus >= 201103L
-  std::size_t find (charT c, std::size_t pos = 0) const noexcept;
-#else
-  std::size_t find (charT c, std::size_t pos = 0) const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Find last occurrence in string : cow::string::rfind(..)
-  //----------------------------------------------------------------------------
-  // string (1)
-#if __cplusplus >= 201103L
-  std::size_t rfind (const std::basic_string<charT,traits,Alloc>& str, std::size_t pos = npos) const noexcept;
-  std::size_t rfind (const cow::basic_string<charT,traits,Alloc>& str, std::size_t pos = npos) const noexcept;
-#else
-  std::size_t rfind (const std::basic_string<charT,traits,Alloc>& str, std::size_t pos = npos) const;
-  std::size_t rfind (const cow::basic_string<charT,traits,Alloc>& str, std::size_t pos = npos) const;
-#endif
-  // c-string (2)
-  std::size_t rfind (const charT* s, std::size_t pos = 0) const;
-  // buffer (3)
-  std::size_t rfind (const charT* s, std::size_t pos, size_type n) const;
-  // character (4)
-#if __cplusplus >= 201103L
-  std::size_t rfind (charT c, std::size_t pos = 0) const noexcept;
-#else
-  std::size_t rfind (charT c, std::size_t pos = 0) const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Find character in string : cow::string::find_first_of(..)
-  //----------------------------------------------------------------------------
-  // string (1)
-#if __cplusplus >= 201103L
-  size_type find_first_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
-  size_type find_first_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
-#else
-  size_type find_first_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
-  size_type find_first_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
-#endif
-  // c-string (2)
-  size_type find_first_of (const charT* s, size_type pos = 0) const;
-  // buffer (3)
-  size_type find_first_of (const charT* s, size_type pos, size_type n) const;
-  // character (4)
-#if __cplusplus >= 201103L
-  size_type find_first_of (charT c, size_type pos = 0) const noexcept;
-#else
-  size_type find_first_of (charT c, size_type pos = 0) const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Find character in string from the end : cow::string::find_last_of(..)
-  //----------------------------------------------------------------------------
-  // string (1)
-#if __cplusplus >= 201103L
-  size_type find_last_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
-  size_type find_last_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
-#else
-  size_type find_last_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
-  size_type find_last_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
-#endif
-  // c-string (2)
-  size_type find_last_of (const charT* s, size_type pos = 0) const;
-  // buffer (3)
-  size_type find_last_of (const charT* s, size_type pos, size_type n) const;
-  // character (4)
-#if __cplusplus >= 201103L
-  size_type find_last_of (charT c, size_type pos = 0) const noexcept;
-#else
-  size_type find_last_of (charT c, size_type pos = 0) const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Find non-matching character in string string : cow::string::find_first_not_of(..)
-  //----------------------------------------------------------------------------
-  // string (1)
-#if __cplusplus >= 201103L
-  size_type find_first_not_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
-  size_type find_first_not_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
-#else
-  size_type find_first_not_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
-  size_type find_first_not_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
-#endif
-  // c-string (2)
-  size_type find_first_not_of (const charT* s, size_type pos = 0) const;
-  // buffer (3)
-  size_type find_first_not_of (const charT* s, size_type pos, size_type n) const;
-  // character (4)
-#if __cplusplus >= 201103L
-  size_type find_first_not_of (charT c, size_type pos = 0) const noexcept;
-#else
-  size_type find_first_not_of (charT c, size_type pos = 0) const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Find non-matching character in string from the end : cow::string::find_last_not_of(..)
-  //----------------------------------------------------------------------------
-  // string (1)
-#if __cplusplus >= 201103L
-  size_type find_last_not_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
-  size_type find_last_not_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
-#else
-  size_type find_last_not_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
-  size_type find_last_not_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
-#endif
-  // c-string (2)
-  size_type find_last_not_of (const charT* s, size_type pos = 0) const;
-  // buffer (3)
-  size_type find_last_not_of (const charT* s, size_type pos, size_type n) const;
-  // character (4)
-#if __cplusplus >= 201103L
-  size_type find_last_not_of (charT c, size_type pos = 0) const noexcept;
-#else
-  size_type find_last_not_of (charT c, size_type pos = 0) const;
-#endif
-
-
-  //----------------------------------------------------------------------------
-  // Returns a substring : cow::string::substr(..)
-  //----------------------------------------------------------------------------
-#if __cplusplus > 201703L
-  constexpr
-#endif
-  cow::basic_string<charT,traits,Alloc> substr( size_type pos = 0, size_type count = npos ) const;
-
-
-  //----------------------------------------------------------------------------
-  // Compare strings : cow::string::compare(..)
-  //----------------------------------------------------------------------------
-  // string (1)
-#if __cplusplus >= 201103L
-  int compare (const std::basic_string<charT,traits,Alloc>& str) const noexcept;
-  int compare (const cow::basic_string<charT,traits,Alloc>& str) const noexcept;
-#else
-  int compare (const std::basic_string<charT,traits,Alloc>& str) const;
-  int compare (const cow::basic_string<charT,traits,Alloc>& str) const;
-#endif
-  // substrings (2)
-  int compare (size_type pos, size_type len, const std::basic_string<charT,traits,Alloc>& str) const;
-  int compare (size_type pos, size_type len, const cow::basic_string<charT,traits,Alloc>& str) const;
-#if __cplusplus >= 201402L
-  int compare (size_type pos, size_type len, const std::basic_string<charT,traits,Alloc>& str, size_type subpos, size_type sublen = npos) const;
-  int compare (size_type pos, size_type len, const cow::basic_string<charT,traits,Alloc>& str, size_type subpos, size_type sublen = npos) const;
-#else
-  int compare (size_type pos, size_type len, const std::basic_string<charT,traits,Alloc>& str, size_type subpos, size_type sublen) const;
-  int compare (size_type pos, size_type len, const cow::basic_string<charT,traits,Alloc>& str, size_type subpos, size_type sublen) const;
-#endif
-  // c-string (3)
-  int compare (const charT* s) const;
-  int compare (size_type pos, size_type len, const charT* s) const;
-  // buffer (4)
-  int compare (size_type pos, size_type len, const charT* s, size_type n) const;
-  //----------------------------------------------------------------------------
-
-  //----------------------------------------------------------------------------
-  // Implicit std::basic_string conversion
-  // (necessary to add fake overloads for std::basic_string)
-  // Example: std::string s = cow::string("Hello world")
-  //----------------------------------------------------------------------------
-#if ! defined(COWSTRING_IMPLICIT_STDSTRING_OPERATOR) && __cplusplus >= 201103L
-  explicit
-#endif
-  operator std::basic_string<charT,traits,Alloc>()  const;
-
-private:
-  bool _is_readonly() const {
-    return m_ro_string.get() != nullptr;
-  }
-
-  std::basic_string<charT,traits,Alloc>& _get_writeable() {
-    if( _is_readonly() ) {
-      // Copy-On-Write:
-      m_rw_string.reset(new std::basic_string<charT,traits,Alloc>(*m_ro_string.get()));
-      m_ro_string.reset();
-    }
-    return *m_rw_string.get();
-  }
-
-  std::basic_string<charT,traits,Alloc>* _get_string_ptr() const {
-    // Either 'ro' or 'rw' should be NULL if the class specification is respected.
-    // Adding them together gives you the non-NULL variable.
-    std::basic_string<charT,traits,Alloc> *ro = m_ro_string.get();
-    std::basic_string<charT,traits,Alloc> *rw = m_rw_string.get();
-    uintptr_t addr = uintptr_t(ro) + uintptr_t(rw);
-    return reinterpret_cast<std::basic_string<charT,traits,Alloc>*> (addr);
-  }
-
-  std::basic_string<charT,traits,Alloc>& _get_string_ref() {
-    return *_get_string_ptr();
-  }
-
-  const std::basic_string<charT,traits,Alloc>& _get_string_ref() const {
-    return *_get_string_ptr();
-  }
-
-  cow::basic_string<charT,traits,Alloc>& _copy(const cow::basic_string<charT,traits,Alloc>& lhs) {
-    m_rw_string.reset();
-    if( lhs._is_readonly() ) {
-      m_ro_string = lhs.m_ro_string;
-    } else {
-      m_ro_string.reset(new std::basic_string<charT,traits,Alloc>(*lhs.m_rw_string.get()));
-    }
-    return *this;
-  }
-
-  /* Read-only string, copied-on-write to m_rw_string */
-  std::shared_ptr< std::basic_string<charT,traits,Alloc> > m_ro_string;
-
-  /* Read-write string, moved to m_ro_string when this is copied */
-  std::unique_ptr< std::basic_string<charT,traits,Alloc> > m_rw_string;
-
-}; // template class basic_srtring
-
-
-//------------------------------------------------------------------------------
-// Class instantiations
-//------------------------------------------------------------------------------
-typedef cow::basic_string<char>      string;
-typedef cow::basic_string<char16_t>  u16string;
-typedef cow::basic_string<char32_t>  u32string;
-typedef cow::basic_string<wchar_t>   wstring;
-
-
-} // namespace cow::
-
-
-#if 0
-//------------------------------------------------------------------------------
-// Template specialization : std::hash<cow_string>
-//------------------------------------------------------------------------------
-namespace std {
-  template<> struct hash<cow_string> {
-    std::size_t operator()(const cow_string& s) const
-#if __cplusplus >= 201103L
-      noexcept
-#endif
-    {
-      return s.hash();
-    }
-  };
-}
-#endif
-
-
-//------------------------------------------------------------------------------
-// Concatenate strings : operator+ (cow::basic_string)
-//------------------------------------------------------------------------------
-
-// string (1.1)
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
-                                        const cow::basic_string<charT,t,A>& rhs);
-
-// string (1.2)
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (const std::basic_string<charT,t,A>& lhs,
-                                        const cow::basic_string<charT,t,A>& rhs);
-
-// string (1.3)
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
-                                        const std::basic_string<charT,t,A>& rhs);
-
-// c-string (2)
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
-                                        const charT*                        rhs);
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (const charT*                        lhs,
-                                        const cow::basic_string<charT,t,A>& rhs);
-
-// character (3)
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
-                                        charT                               rhs);
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (charT                               lhs,
-                                        const cow::basic_string<charT,t,A>& rhs);
-
-#if __cplusplus >= 201103L // move semantics
-
-// string (1.1)
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
-                                        cow::basic_string<charT,t,A>&&      rhs);
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
-                                        const cow::basic_string<charT,t,A>& rhs);
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
-                                        cow::basic_string<charT,t,A>&&      rhs);
-
-// string (1.2)
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (std::basic_string<charT,t,A>&&      lhs,
-                                        cow::basic_string<charT,t,A>&&      rhs);
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (std::basic_string<charT,t,A>&&      lhs,
-                                        const cow::basic_string<charT,t,A>& rhs);
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (const std::basic_string<charT,t,A>& lhs,
-                                        cow::basic_string<charT,t,A>&&      rhs);
-
-// string (1.3)
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
-                                        std::basic_string<charT,t,A>&&      rhs);
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
-                                        const std::basic_string<charT,t,A>& rhs);
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
-                                        std::basic_string<charT,t,A>&&      rhs);
-
-// c-string (2)
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
-                                        const charT*                        rhs);
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (const charT*                        lhs,
-                                        cow::basic_string<charT,t,A>&&      rhs);
+#include "cow_string_decl.hpp"
 
-// character (3)
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
-                                        charT                               rhs);
-template < class charT, class t, class A >
-cow::basic_string<charT,t,A> operator+ (charT                               lhs,
-                                        cow::basic_string<charT,t,A>&&      rhs);
+#if COWSTRING_HAVE_MMAP
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+# include <unistd.h>
 #endif
 
 
-//------------------------------------------------------------------------------
-// Insert string into stream : operator<< (cow::basic_string)
-//------------------------------------------------------------------------------
-template < class charT, class t, class A >
-std::ostream& operator<< (std::ostream& os, const cow::basic_string<charT,t,A>& str);
-
-
 //------------------------------------------------------------------------------
 // Implementation
 //------------------------------------------------------------------------------
-#define COWSTRING_UNIMPLEMENTED() \
-  do { std::abort(); } while(0)
-
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>::basic_string()
-: m_ro_string(new std::basic_string<charT,traits,Alloc>())
+: m_ro_string()
+, m_ro_length(0)
+, m_ro_prefix(0)
 , m_rw_string()
 {
+  _set_empty();
 }
 
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>::basic_string(
   const cow::basic_string<charT,traits,Alloc>& str)
 : m_ro_string()
+, m_ro_length(0)
+, m_ro_prefix(0)
 , m_rw_string()
 {
   _copy(str);
@@ -752,9 +49,12 @@ cow::basic_string<charT,traits,Alloc>::basic_string(
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>::basic_string(
   const std::basic_string<charT,traits,Alloc>& str)
-: m_ro_string(new std::basic_string<charT,traits,Alloc>(str))
+: m_ro_string()
+, m_ro_length(0)
+, m_ro_prefix(0)
 , m_rw_string()
 {
+  _set_readonly(std::basic_string<charT,traits,Alloc>(str));
 }
 
 template < class charT, class traits, class Alloc >
@@ -762,9 +62,18 @@ cow::basic_string<charT,traits,Alloc>::basic_string(
   const cow::basic_string<charT,traits,Alloc>& str,
   std::size_t pos,
   std::size_t len)
-: m_ro_string(new std::basic_string<charT,traits,Alloc>(str._get_string_ref(), pos, len))
+: m_ro_string()
+, m_ro_length(0)
+, m_ro_prefix(0)
 , m_rw_string()
 {
+  len = _clamp(str, pos, len);
+  if( str._is_readonly() && pos + len == str.m_ro_length ) {
+    // A suffix is still NUL-terminated: share it.
+    _set_readonly(_shared_chars(str.m_ro_string, str.m_ro_string.get() + pos), len);
+    return;
+  }
+  _set_readonly(std::basic_string<charT,traits,Alloc>(str._get_data() + pos, len));
 }
 
 template < class charT, class traits, class Alloc >
@@ -772,35 +81,47 @@ cow::basic_string<charT,traits,Alloc>::basic_string(
   const std::basic_string<charT,traits,Alloc>& str,
   std::size_t pos,
   std::size_t len)
-: m_ro_string(new std::basic_string<charT,traits,Alloc>(str, pos, len))
+: m_ro_string()
+, m_ro_length(0)
+, m_ro_prefix(0)
 , m_rw_string()
 {
+  _set_readonly(std::basic_string<charT,traits,Alloc>(str, pos, len));
 }
 
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>::basic_string(
-  const char* nul_terminated_c_str)
-: m_ro_string(new std::basic_string<charT,traits,Alloc>(nul_terminated_c_str))
+  const charT* nul_terminated_c_str)
+: m_ro_string()
+, m_ro_length(0)
+, m_ro_prefix(0)
 , m_rw_string()
 {
+  _set_readonly(std::basic_string<charT,traits,Alloc>(nul_terminated_c_str));
 }
 
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>::basic_string(
-  const char* s,
+  const charT* s,
   std::size_t n)
-: m_ro_string(new std::basic_string<charT,traits,Alloc>(s, n))
+: m_ro_string()
+, m_ro_length(0)
+, m_ro_prefix(0)
 , m_rw_string()
 {
+  _set_readonly(std::basic_string<charT,traits,Alloc>(s, n));
 }
 
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>::basic_string(
   std::size_t n,
-  char c)
-: m_ro_string(new std::basic_string<charT,traits,Alloc>(n, c))
+  charT c)
+: m_ro_string()
+, m_ro_length(0)
+, m_ro_prefix(0)
 , m_rw_string()
 {
+  _set_readonly(std::basic_string<charT,traits,Alloc>(n, c));
 }
 
 template < class charT, class traits, class Alloc >
@@ -808,34 +129,46 @@ template < class InputIterator >
 cow::basic_string<charT,traits,Alloc>::basic_string(
   InputIterator first,
   InputIterator last)
-: m_ro_string(new std::basic_string<charT,traits,Alloc>(first, last))
+: m_ro_string()
+, m_ro_length(0)
+, m_ro_prefix(0)
 , m_rw_string()
 {
+  _set_readonly(std::basic_string<charT,traits,Alloc>(first, last));
 }
 
 #if __cplusplus >= 201103L
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>::basic_string(
-  std::initializer_list<char> il)
-: m_ro_string(new std::basic_string<charT,traits,Alloc>(il))
+  std::initializer_list<charT> il)
+: m_ro_string()
+, m_ro_length(0)
+, m_ro_prefix(0)
 , m_rw_string()
 {
+  _set_readonly(std::basic_string<charT,traits,Alloc>(il));
 }
 
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>::basic_string(
-  cow::basic_string<charT,traits,Alloc>&& str)
+  cow::basic_string<charT,traits,Alloc>&& str) noexcept
 : m_ro_string(std::move(str.m_ro_string))
+, m_ro_length(str.m_ro_length)
+, m_ro_prefix(str.m_ro_prefix)
 , m_rw_string(std::move(str.m_rw_string))
 {
+  str._set_empty();
 }
 
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>::basic_string(
   std::basic_string<charT,traits,Alloc>&& str)
-: m_ro_string(new std::basic_string<charT,traits,Alloc>(str))
+: m_ro_string()
+, m_ro_length(0)
+, m_ro_prefix(0)
 , m_rw_string()
 {
+  _set_readonly(std::move(str));
 }
 #endif
 
@@ -844,12 +177,189 @@ cow::basic_string<charT,traits,Alloc>::~basic_string()
 {
 }
 
+#if COWSTRING_HAVE_MMAP
+namespace cow {
+  // Deleter of the read-only buffer returned by map_file.
+  struct _munmap_deleter {
+    std::size_t length;
+    void operator() (const void* addr) const noexcept {
+      if( !cow::_reclaim_domain::get().defer(&_munmap, const_cast<void*>(addr), length) ) {
+        _munmap(const_cast<void*>(addr), length);
+      }
+    }
+    static void _munmap(void* addr, std::size_t length) {
+      ::munmap(addr, length);
+    }
+  };
+}
+#endif
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::basic_string<charT,traits,Alloc>::map_file(const char* path)
+{
+  cow::basic_string<charT,traits,Alloc> result;
+#if COWSTRING_HAVE_MMAP
+  const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if( fd < 0 ) {
+    throw std::system_error(errno, std::generic_category(), path);
+  }
+  struct stat st;
+  if( ::fstat(fd, &st) != 0 ) {
+    const int err = errno;
+    ::close(fd);
+    throw std::system_error(err, std::generic_category(), path);
+  }
+  const std::size_t bytes = static_cast<std::size_t>(st.st_size);
+  // Pipes, devices & files with a partial trailing character are read below.
+  if( S_ISREG(st.st_mode) && bytes != 0 && bytes % sizeof(charT) == 0 ) {
+    // Reserve one extra character of anonymous zero pages and map the file
+    // over the front of it, so that c_str() is NUL-terminated even when the
+    // file size is a multiple of the page size.
+    const std::size_t length = bytes + sizeof(charT);
+    void* addr = ::mmap(nullptr, length, PROT_READ, MAP_PRIVATE | MAP_ANON, -1, 0);
+    if( addr != MAP_FAILED &&
+        ::mmap(addr, bytes, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED ) {
+      ::munmap(addr, length);
+      addr = MAP_FAILED;
+    }
+    const int err = errno;
+    ::close(fd);
+    if( addr == MAP_FAILED ) {
+      throw std::system_error(err, std::generic_category(), path);
+    }
+    result._set_readonly(
+      _shared_chars(static_cast<const charT*>(addr), cow::_munmap_deleter{length}),
+      bytes / sizeof(charT));
+    return result;
+  }
+  ::close(fd);
+#endif
+  return read_file(path);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::basic_string<charT,traits,Alloc>::map_file(const std::string& path)
+{
+  return map_file(path.c_str());
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::basic_string<charT,traits,Alloc>::read_file(const char* path)
+{
+  std::FILE* file = std::fopen(path, "rb");
+  if( file == nullptr ) {
+    throw std::system_error(errno, std::generic_category(), path);
+  }
+  std::basic_string<charT,traits,Alloc> str;
+  // Size the buffer from the file (plus one character to see the end of it
+  // without growing), if it is seekable.
+  if( std::fseek(file, 0, SEEK_END) == 0 ) {
+    const long end = std::ftell(file);
+    if( end > 0 ) {
+      str.resize(static_cast<std::size_t>(end) / sizeof(charT) + 1);
+    }
+    std::rewind(file);
+  }
+  std::clearerr(file);
+  // Read bytes, to see a partial trailing character.
+  std::size_t bytes = 0;
+  std::size_t wanted;
+  std::size_t n;
+  do {
+    const std::size_t size = bytes / sizeof(charT);
+    if( bytes == str.size() * sizeof(charT) ) {
+      str.resize(size < 4096 / sizeof(charT) ? 4096 / sizeof(charT) : size * 2);
+    }
+    wanted = str.size() * sizeof(charT) - bytes;
+    n = std::fread(reinterpret_cast<char*>(&str[0]) + bytes, 1, wanted, file);
+    bytes += n;
+  } while( n == wanted );
+  const bool failed = std::ferror(file) != 0;
+  std::fclose(file);
+  if( failed ) {
+    throw std::system_error(EIO, std::generic_category(), path);
+  }
+  if( bytes % sizeof(charT) != 0 ) {
+    throw std::system_error(EILSEQ, std::generic_category(), path);
+  }
+  return _adopt(std::move(str), bytes / sizeof(charT));
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::basic_string<charT,traits,Alloc>::read_file(const std::string& path)
+{
+  return read_file(path.c_str());
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::basic_string<charT,traits,Alloc>::read_stream(std::basic_istream<charT,traits>& is)
+{
+  std::basic_string<charT,traits,Alloc> str;
+  std::size_t size = 0;
+  const typename std::basic_istream<charT,traits>::sentry ok(is, true);
+  if( ok ) {
+    std::basic_streambuf<charT,traits>* buf = is.rdbuf();
+    std::streamsize wanted;
+    std::streamsize n;
+    do {
+      if( size == str.size() ) {
+        str.resize(size < 4096 ? 4096 : size * 2);
+      }
+      wanted = static_cast<std::streamsize>(str.size() - size);
+      n = buf->sgetn(&str[size], wanted);
+      size += static_cast<std::size_t>(n);
+    } while( n == wanted );
+    is.setstate(std::ios_base::eofbit);
+  }
+  return _adopt(std::move(str), size);
+}
+
+template < class charT, class traits, class Alloc >
+void
+cow::basic_string<charT,traits,Alloc>::freeze()
+{
+  if( _is_immortal() ) {
+    return;
+  }
+  if( _is_readonly() ) {
+    // Leak one reference so the buffer can't be freed by other sharers.
+    new _shared_chars(m_ro_string);
+    _set_immortal(m_ro_string.get(), m_ro_length);
+  } else {
+    // Leak the writeable string: no control block is needed at all.
+    std::basic_string<charT,traits,Alloc>* str = m_rw_string.release();
+    _set_immortal(str->data(), str->size());
+  }
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::basic_string<charT,traits,Alloc>::from_static(const charT* s)
+{
+  return from_static(s, traits::length(s));
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>
+cow::basic_string<charT,traits,Alloc>::from_static(const charT* s, std::size_t n)
+{
+  cow::basic_string<charT,traits,Alloc> result;
+  result._set_immortal(s, n);
+  return result;
+}
+
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>&
 cow::basic_string<charT,traits,Alloc>::operator= (
   const std::basic_string<charT,traits,Alloc>& str)
 {
-  COWSTRING_UNIMPLEMENTED();
+  _set_readonly(std::basic_string<charT,traits,Alloc>(str));
+  return *this;
 }
 
 template < class charT, class traits, class Alloc >
@@ -862,40 +372,48 @@ cow::basic_string<charT,traits,Alloc>::operator= (
 
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>&
-cow::basic_string<charT,traits,Alloc>::operator= (const char* s)
+cow::basic_string<charT,traits,Alloc>::operator= (const charT* s)
 {
-  COWSTRING_UNIMPLEMENTED();
+  _set_readonly(std::basic_string<charT,traits,Alloc>(s));
+  return *this;
 }
 
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>&
-cow::basic_string<charT,traits,Alloc>::operator= (char c)
+cow::basic_string<charT,traits,Alloc>::operator= (charT c)
 {
-  COWSTRING_UNIMPLEMENTED();
+  _set_readonly(std::basic_string<charT,traits,Alloc>(1, c));
+  return *this;
 }
 
 #if __cplusplus >= 201103L
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>&
-cow::basic_string<charT,traits,Alloc>::operator= (std::initializer_list<char> il)
+cow::basic_string<charT,traits,Alloc>::operator= (std::initializer_list<charT> il)
 {
-  COWSTRING_UNIMPLEMENTED();
+  _set_readonly(std::basic_string<charT,traits,Alloc>(il));
+  return *this;
 }
 
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>&
-cow::basic_string<charT,traits,Alloc>::operator= (std::basic_string<charT,traits,Alloc>&& str) noexcept
+cow::basic_string<charT,traits,Alloc>::operator= (std::basic_string<charT,traits,Alloc>&& str)
 {
-  COWSTRING_UNIMPLEMENTED();
+  _set_readonly(std::move(str));
+  return *this;
 }
 
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>&
 cow::basic_string<charT,traits,Alloc>::operator= (cow::basic_string<charT,traits,Alloc>&& str) noexcept
 {
-  m_ro_string = str.m_ro_string;
-  m_rw_string.reset( str.m_rw_string.release() );
-  str.clear();
+  if( this != &str ) {
+    m_ro_string = std::move( str.m_ro_string );
+    m_ro_length = str.m_ro_length;
+    m_ro_prefix = str.m_ro_prefix;
+    m_rw_string = std::move( str.m_rw_string );
+    str._set_empty();
+  }
   return *this;
 }
 #endif
@@ -907,7 +425,7 @@ cow::basic_string<charT,traits,Alloc>::begin()
   noexcept
 #endif
 {
-  return _get_writeable().begin();
+  return &_get_writeable()[0];
 }
 
 template < class charT, class traits, class Alloc >
@@ -917,7 +435,7 @@ cow::basic_string<charT,traits,Alloc>::begin() const
   noexcept
 #endif
 {
-  return _get_string_ref().begin();
+  return _get_data();
 }
 
 template < class charT, class traits, class Alloc >
@@ -927,7 +445,8 @@ cow::basic_string<charT,traits,Alloc>::end()
   noexcept
 #endif
 {
-  return _get_writeable().end();
+  std::basic_string<charT,traits,Alloc>& str = _get_writeable();
+  return &str[0] + str.size();
 }
 
 template < class charT, class traits, class Alloc >
@@ -937,7 +456,7 @@ cow::basic_string<charT,traits,Alloc>::end() const
   noexcept
 #endif
 {
-  return _get_string_ref().end();
+  return _get_data() + _get_size();
 }
 
 template < class charT, class traits, class Alloc >
@@ -947,7 +466,7 @@ cow::basic_string<charT,traits,Alloc>::rbegin()
   noexcept
 #endif
 {
-  return _get_writeable().rbegin();
+  return reverse_iterator( end() );
 }
 
 template < class charT, class traits, class Alloc >
@@ -957,7 +476,7 @@ cow::basic_string<charT,traits,Alloc>::rbegin() const
   noexcept
 #endif
 {
-  return _get_string_ref().rbegin();
+  return const_reverse_iterator( end() );
 }
 
 template < class charT, class traits, class Alloc >
@@ -967,7 +486,7 @@ cow::basic_string<charT,traits,Alloc>::rend()
   noexcept
 #endif
 {
-  return _get_writeable().rend();
+  return reverse_iterator( begin() );
 }
 
 template < class charT, class traits, class Alloc >
@@ -977,7 +496,7 @@ cow::basic_string<charT,traits,Alloc>::rend() const
   noexcept
 #endif
 {
-  return _get_string_ref().rend();
+  return const_reverse_iterator( begin() );
 }
 
 #if __cplusplus >= 201103L
@@ -985,28 +504,28 @@ template < class charT, class traits, class Alloc >
 typename cow::basic_string<charT,traits,Alloc>::const_iterator
 cow::basic_string<charT,traits,Alloc>::cbegin() const noexcept
 {
-  return _get_string_ref().cbegin();
+  return begin();
 }
 
 template < class charT, class traits, class Alloc >
 typename cow::basic_string<charT,traits,Alloc>::const_iterator
 cow::basic_string<charT,traits,Alloc>::cend() const noexcept
 {
-  return _get_string_ref().cend();
+  return end();
 }
 
 template < class charT, class traits, class Alloc >
 typename cow::basic_string<charT,traits,Alloc>::const_reverse_iterator
 cow::basic_string<charT,traits,Alloc>::crbegin() const noexcept
 {
-  return _get_string_ref().crbegin();
+  return rbegin();
 }
 
 template < class charT, class traits, class Alloc >
 typename cow::basic_string<charT,traits,Alloc>::const_reverse_iterator
 cow::basic_string<charT,traits,Alloc>::crend() const noexcept
 {
-  return _get_string_ref().crend();
+  return rend();
 }
 #endif
 
@@ -1017,7 +536,7 @@ cow::basic_string<charT,traits,Alloc>::size() const
   noexcept
 #endif
 {
-  return _get_string_ref().size();
+  return _get_size();
 }
 
 template < class charT, class traits, class Alloc >
@@ -1027,7 +546,7 @@ cow::basic_string<charT,traits,Alloc>::length() const
   noexcept
 #endif
 {
-  return _get_string_ref().length();
+  return _get_size();
 }
 
 template < class charT, class traits, class Alloc >
@@ -1037,7 +556,7 @@ cow::basic_string<charT,traits,Alloc>::max_size() const
   noexcept
 #endif
 {
-  return _get_string_ref().max_size();
+  return std::basic_string<charT,traits,Alloc>().max_size();
 }
 
 template < class charT, class traits, class Alloc >
@@ -1047,7 +566,57 @@ cow::basic_string<charT,traits,Alloc>::capacity() const
   noexcept
 #endif
 {
-  return _get_string_ref().capacity();
+  // Shared characters can't grow without a copy.
+  return _is_readonly() ? m_ro_length : m_rw_string->capacity();
+}
+
+template < class charT, class traits, class Alloc >
+cow::memory_footprint
+cow::basic_string<charT,traits,Alloc>::memory_footprint() const
+{
+  typedef std::basic_string<charT,traits,Alloc> std_string;
+  // Characters up to this length are stored inside the std::basic_string.
+  static const std::size_t sso_capacity = std_string().capacity();
+
+  cow::memory_footprint result = cow::memory_footprint();
+  result.handle_bytes = sizeof(*this);
+  result.used_bytes   = (_get_size() + 1) * sizeof(charT);
+  if( !_is_readonly() ) {
+    const std_string& rw = *m_rw_string;
+    result.buffer        = rw.data() + rw.size();
+    result.kind          = cow::buffer_writeable;
+    result.control_bytes = sizeof(std_string);
+    result.char_bytes    = rw.capacity() > sso_capacity ? _get_bytes(rw) : 0;
+    result.buffer_bytes  = result.used_bytes;
+    result.use_count     = 1;
+    result.shared        = false;
+    return result;
+  }
+  result.buffer       = m_ro_string.get() + m_ro_length;
+  result.kind         = cow::buffer_immortal;
+  result.buffer_bytes = result.used_bytes;
+  result.use_count    = m_ro_string.use_count();
+  result.shared       = result.use_count > 1;
+  // The deleter tells what owns the characters.
+  const std_string* owner = nullptr;
+  if( const _heap_owner* heap = cow::_get_deleter<_heap_owner>(m_ro_string) ) {
+    owner                = &heap->str;
+    result.kind          = cow::buffer_heap;
+    result.control_bytes = _get_control_bytes<_heap_owner>();
+  }
+#if COWSTRING_HAVE_MMAP
+  else if( const cow::_munmap_deleter* mapped = cow::_get_deleter<cow::_munmap_deleter>(m_ro_string) ) {
+    result.kind          = cow::buffer_mapped;
+    result.control_bytes = _get_control_bytes<cow::_munmap_deleter>();
+    result.mapped_bytes  = mapped->length;
+    result.buffer_bytes  = mapped->length;
+  }
+#endif
+  if( owner != nullptr ) {
+    result.char_bytes   = owner->capacity() > sso_capacity ? _get_bytes(*owner) : 0;
+    result.buffer_bytes = (owner->size() + 1) * sizeof(charT);
+  }
+  return result;
 }
 
 template < class charT, class traits, class Alloc >
@@ -1057,7 +626,7 @@ cow::basic_string<charT,traits,Alloc>::empty() const
   noexcept
 #endif
 {
-  return _get_string_ref().empty();
+  return _get_size() == 0;
 }
 
 template < class charT, class traits, class Alloc >
@@ -1069,7 +638,7 @@ cow::basic_string<charT,traits,Alloc>::resize(std::size_t n)
 
 template < class charT, class traits, class Alloc >
 void
-cow::basic_string<charT,traits,Alloc>::resize(std::size_t n, char c)
+cow::basic_string<charT,traits,Alloc>::resize(std::size_t n, charT c)
 {
   _get_writeable().resize(n, c);
 }
@@ -1081,8 +650,12 @@ cow::basic_string<charT,traits,Alloc>::clear()
   noexcept
 #endif
 {
-  m_ro_string = nullptr;
-  m_rw_string.reset(new std::basic_string<charT,traits,Alloc>());
+  if( _is_readonly() ) {
+    // Drop the shared characters rather than copying them to erase them.
+    _set_empty();
+  } else {
+    m_rw_string->clear();
+  }
 }
 
 #if __cplusplus >= 201103L
@@ -1106,7 +679,7 @@ template < class charT, class traits, class Alloc >
 const charT&
 cow::basic_string<charT,traits,Alloc>::back() const
 {
-  return _get_string_ref().back();
+  return _get_data()[_get_size() - 1];
 }
 
 template < class charT, class traits, class Alloc >
@@ -1120,7 +693,7 @@ template < class charT, class traits, class Alloc >
 const charT&
 cow::basic_string<charT,traits,Alloc>::front() const
 {
-  return _get_string_ref().front();
+  return _get_data()[0];
 }
 #endif
 
@@ -1137,7 +710,7 @@ cow::basic_string<charT,traits,Alloc>&
 cow::basic_string<charT,traits,Alloc>::operator+= (
   const std::basic_string<charT,traits,Alloc>& str)
 {
-  return append( str );
+  return append( str.data(), str.size() );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1171,7 +744,8 @@ cow::basic_string<charT,traits,Alloc>&
 cow::basic_string<charT,traits,Alloc>::append(
   const cow::basic_string<charT,traits,Alloc>& str)
 {
-  _get_writeable().append( str._get_string_ref() );
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  rw.append( str._get_data(), str._get_size() );
   return *this;
 }
 
@@ -1182,7 +756,9 @@ cow::basic_string<charT,traits,Alloc>::append(
   std::size_t subpos,
   std::size_t sublen)
 {
-  _get_writeable().append( str._get_string_ref(), subpos, sublen );
+  sublen = _clamp( str, subpos, sublen );
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  rw.append( str._get_data() + subpos, sublen );
   return *this;
 }
 
@@ -1237,19 +813,25 @@ cow::basic_string<charT,traits,Alloc>::append(
 }
 #endif
 
+template < class charT, class traits, class Alloc >
+void
+cow::basic_string<charT,traits,Alloc>::push_back(charT c)
+{
+  _get_writeable().push_back(c);
+}
+
 template < class charT, class traits, class Alloc >
 void
 cow::basic_string<charT,traits,Alloc>::swap(
   cow::basic_string<charT,traits,Alloc>& str)
+#if __cplusplus >= 201103L
+  noexcept
+#endif
 {
-  std::shared_ptr< std::basic_string<charT,traits,Alloc> >
-    tmp_ro = str.m_ro_string;
-  std::basic_string<charT,traits,Alloc>*
-    tmp_rw = str.m_rw_string.release();
-  str.m_ro_string = this->m_ro_string;
-  str.m_rw_string.reset( this->m_rw_string.release() );
-  this->m_ro_string = tmp_ro;
-  this->m_rw_string.reset( tmp_rw );
+  m_ro_string.swap( str.m_ro_string );
+  std::swap( m_ro_length, str.m_ro_length );
+  std::swap( m_ro_prefix, str.m_ro_prefix );
+  m_rw_string.swap( str.m_rw_string );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1257,7 +839,13 @@ void
 cow::basic_string<charT,traits,Alloc>::swap(
   std::basic_string<charT,traits,Alloc>& str)
 {
-  COWSTRING_UNIMPLEMENTED();
+  if( _is_readonly() ) {
+    std::basic_string<charT,traits,Alloc> other( std::move(str) );
+    str.assign( m_ro_string.get(), m_ro_length );
+    _set_readonly( std::move(other) );
+  } else {
+    m_rw_string->swap( str );
+  }
 }
 
 #if __cplusplus >= 201103L
@@ -1280,7 +868,7 @@ template < class charT, class traits, class Alloc >
 const charT&
 cow::basic_string<charT,traits,Alloc>::operator[] (std::size_t pos) const
 {
-  return _get_string_ref()[pos];
+  return _get_data()[pos];
 }
 
 template < class charT, class traits, class Alloc >
@@ -1299,7 +887,8 @@ cow::basic_string<charT,traits,Alloc>::insert(
   std::size_t pos,
   const cow::basic_string<charT,traits,Alloc>& str)
 {
-  _get_writeable().insert(pos, str._get_string_ref());
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  rw.insert(pos, str._get_data(), str._get_size());
   return *this;
 }
 
@@ -1324,7 +913,9 @@ cow::basic_string<charT,traits,Alloc>::insert(
   std::size_t subpos,
   std::size_t sublen)
 {
-  _get_writeable().insert(pos, str._get_string_ref(), subpos, sublen);
+  sublen = _clamp(str, subpos, sublen);
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  rw.insert(pos, str._get_data() + subpos, sublen);
   return *this;
 }
 
@@ -1360,7 +951,9 @@ cow::basic_string<charT,traits,Alloc>::insert(
   cow::basic_string<charT,traits,Alloc>::const_iterator p,
   std::size_t n, charT c)
 {
-  return _get_writeable().insert(p, n, c);
+  const std::size_t pos = p - _get_data();
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  return _to_iterator(rw, rw.insert(rw.begin() + pos, n, c));
 }
 
 template < class charT, class traits, class Alloc >
@@ -1368,7 +961,9 @@ typename cow::basic_string<charT,traits,Alloc>::iterator
 cow::basic_string<charT,traits,Alloc>::insert(
   cow::basic_string<charT,traits,Alloc>::const_iterator p, charT c)
 {
-  return _get_writeable().insert(p, c);
+  const std::size_t pos = p - _get_data();
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  return _to_iterator(rw, rw.insert(rw.begin() + pos, c));
 }
 
 #if __cplusplus >= 201103L
@@ -1379,7 +974,9 @@ cow::basic_string<charT,traits,Alloc>::insert(
   cow::basic_string<charT,traits,Alloc>::iterator p,
   InputIterator first, InputIterator last)
 {
-  return _get_writeable().insert(p, first, last);
+  const std::size_t pos = p - _get_data();
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  return _to_iterator(rw, rw.insert(rw.begin() + pos, first, last));
 }
 
 template < class charT, class traits, class Alloc >
@@ -1388,7 +985,8 @@ cow::basic_string<charT,traits,Alloc>::insert(
   cow::basic_string<charT,traits,Alloc>::const_iterator p,
   std::initializer_list<charT> il)
 {
-  _get_writeable().insert(p, il);
+  const std::size_t pos = p - _get_data();
+  _get_writeable().insert(pos, il.begin(), il.size());
   return *this;
 }
 #endif
@@ -1412,7 +1010,9 @@ typename cow::basic_string<charT,traits,Alloc>::iterator
 cow::basic_string<charT,traits,Alloc>::erase(
   cow::basic_string<charT,traits,Alloc>::const_iterator p)
 {
-  return _get_writeable().erase(p);
+  const std::size_t pos = p - _get_data();
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  return _to_iterator(rw, rw.erase(rw.begin() + pos));
 }
 
 template < class charT, class traits, class Alloc >
@@ -1421,7 +1021,10 @@ cow::basic_string<charT,traits,Alloc>::erase(
   cow::basic_string<charT,traits,Alloc>::const_iterator first,
   cow::basic_string<charT,traits,Alloc>::const_iterator last)
 {
-  return _get_writeable().erase(first, last);
+  const std::size_t pos = first - _get_data();
+  const std::size_t len = last - first;
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  return _to_iterator(rw, rw.erase(rw.begin() + pos, rw.begin() + pos + len));
 }
 #endif
 
@@ -1443,7 +1046,8 @@ cow::basic_string<charT,traits,Alloc>::replace(
   std::size_t len,
   const cow::basic_string<charT,traits,Alloc>& str)
 {
-  _get_writeable().replace( pos, len, str._get_string_ref() );
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  rw.replace( pos, len, str._get_data(), str._get_size() );
   return *this;
 }
 
@@ -1454,7 +1058,8 @@ cow::basic_string<charT,traits,Alloc>::replace(
   const_iterator i2,
   const std::basic_string<charT,traits,Alloc>& str)
 {
-  _get_writeable().replace( i1, i2, str );
+  const std::size_t pos = i1 - _get_data();
+  _get_writeable().replace( pos, i2 - i1, str );
   return *this;
 }
 
@@ -1465,7 +1070,9 @@ cow::basic_string<charT,traits,Alloc>::replace(
   const_iterator i2,
   const cow::basic_string<charT,traits,Alloc>& str)
 {
-  _get_writeable().replace( i1, i2, str._get_string_ref() );
+  const std::size_t pos = i1 - _get_data();
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  rw.replace( pos, i2 - i1, str._get_data(), str._get_size() );
   return *this;
 }
 
@@ -1491,7 +1098,9 @@ cow::basic_string<charT,traits,Alloc>::replace(
   std::size_t subpos,
   std::size_t sublen)
 {
-  _get_writeable().replace( pos, len, str._get_string_ref(), subpos, sublen );
+  sublen = _clamp( str, subpos, sublen );
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  rw.replace( pos, len, str._get_data() + subpos, sublen );
   return *this;
 }
 
@@ -1513,7 +1122,8 @@ cow::basic_string<charT,traits,Alloc>::replace(
   const_iterator i2,
   const charT* s)
 {
-  _get_writeable().replace( i1, i2, s );
+  const std::size_t pos = i1 - _get_data();
+  _get_writeable().replace( pos, i2 - i1, s );
   return *this;
 }
 
@@ -1537,7 +1147,8 @@ cow::basic_string<charT,traits,Alloc>::replace(
   const charT* s,
   std::size_t n)
 {
-  _get_writeable().replace( i1, i2, s, n );
+  const std::size_t pos = i1 - _get_data();
+  _get_writeable().replace( pos, i2 - i1, s, n );
   return *this;
 }
 
@@ -1561,7 +1172,8 @@ cow::basic_string<charT,traits,Alloc>::replace(
   std::size_t n,
   charT c)
 {
-  _get_writeable().replace( i1, i2, n, c );
+  const std::size_t pos = i1 - _get_data();
+  _get_writeable().replace( pos, i2 - i1, n, c );
   return *this;
 }
 
@@ -1574,7 +1186,10 @@ cow::basic_string<charT,traits,Alloc>::replace(
   InputIterator first,
   InputIterator last)
 {
-  _get_writeable().replace( i1, i2, first, last );
+  const std::size_t pos = i1 - _get_data();
+  const std::size_t len = i2 - i1;
+  std::basic_string<charT,traits,Alloc>& rw = _get_writeable();
+  rw.replace( rw.begin() + pos, rw.begin() + pos + len, first, last );
   return *this;
 }
 
@@ -1586,11 +1201,147 @@ cow::basic_string<charT,traits,Alloc>::replace(
   const_iterator i2,
   std::initializer_list<charT> il)
 {
-  _get_writeable().replace( i1, i2, il );
+  const std::size_t pos = i1 - _get_data();
+  _get_writeable().replace( pos, i2 - i1, il.begin(), il.size() );
   return *this;
 }
 #endif
 
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>&
+cow::basic_string<charT,traits,Alloc>::replace_all(
+  const cow::basic_string<charT,traits,Alloc>& from,
+  const cow::basic_string<charT,traits,Alloc>& to)
+{
+  const _replacement pair = { from._get_data(), from._get_size(), to._get_data(), to._get_size() };
+  return _replace_all( &pair, 1 );
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>&
+cow::basic_string<charT,traits,Alloc>::replace_all(
+  const charT* from,
+  const charT* to)
+{
+  const _replacement pair = { from, traits::length(from), to, traits::length(to) };
+  return _replace_all( &pair, 1 );
+}
+
+#if __cplusplus >= 201103L
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>&
+cow::basic_string<charT,traits,Alloc>::replace_all(
+  std::initializer_list< std::pair<const charT*, const charT*> > pairs)
+{
+  // Usually a handful of pairs: keep them on the stack.
+  _replacement local[16];
+  std::vector<_replacement> heap;
+  _replacement* list = local;
+  if( pairs.size() > 16 ) {
+    heap.resize( pairs.size() );
+    list = heap.data();
+  }
+  std::size_t n = 0;
+  for( const std::pair<const charT*, const charT*>& p : pairs ) {
+    const _replacement r = { p.first, traits::length(p.first), p.second, traits::length(p.second) };
+    list[n++] = r;
+  }
+  return _replace_all( list, n );
+}
+#endif
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc>&
+cow::basic_string<charT,traits,Alloc>::_replace_all(
+  const _replacement* pairs,
+  std::size_t n)
+{
+  // Characters starting a 'from', to skip the others quickly. Only for
+  // std::char_traits: other traits may equate different bytes.
+  bool table[256] = {};
+  const bool* first_chars = nullptr;
+  if( sizeof(charT) == 1 && _char_kernel_of<charT,traits>::value != _kernel_traits ) {
+    for( std::size_t i = 0; i < n; ++i ) {
+      if( pairs[i].from_size != 0 ) {
+        table[static_cast<unsigned char>(pairs[i].from[0])] = true;
+      }
+    }
+    first_chars = table;
+  }
+  const charT* const data = _get_data();
+  const std::size_t  size = _get_size();
+
+  // Count:
+  std::size_t new_size = size;
+  std::size_t matches = 0;
+  const _replacement* match = nullptr;
+  for( std::size_t pos = _find_any( data, size, 0, pairs, n, first_chars, &match );
+       pos != npos;
+       pos = _find_any( data, size, pos + match->from_size, pairs, n, first_chars, &match ) ) {
+    new_size = new_size - match->from_size + match->to_size;
+    ++matches;
+  }
+  if( matches == 0 ) {
+    return *this;
+  }
+
+  // Write:
+  std::basic_string<charT,traits,Alloc> result;
+  result.reserve( new_size );
+  std::size_t done = 0;
+  for( std::size_t pos = _find_any( data, size, 0, pairs, n, first_chars, &match );
+       pos != npos;
+       pos = _find_any( data, size, done, pairs, n, first_chars, &match ) ) {
+    result.append( data + done, pos - done );
+    result.append( match->to, match->to_size );
+    done = pos + match->from_size;
+  }
+  result.append( data + done, size - done );
+
+  if( _is_readonly() ) {
+    _set_readonly( std::move(result) );
+  } else {
+    *m_rw_string = std::move(result);
+  }
+  return *this;
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_string<charT,traits,Alloc>::_find_any(
+  const charT* data,
+  std::size_t size,
+  std::size_t pos,
+  const _replacement* pairs,
+  std::size_t n,
+  const bool* first_chars,
+  const _replacement** match)
+{
+  if( n == 1 ) {
+    // Search for the first character with the _chars kernels (memchr for char).
+    if( pairs[0].from_size == 0 ) {
+      return npos;
+    }
+    *match = pairs;
+    return _find( data, size, pairs[0].from, pos, pairs[0].from_size );
+  }
+  for( ; pos < size; ++pos ) {
+    const charT c = data[pos];
+    if( first_chars != nullptr && !first_chars[static_cast<unsigned char>(c)] ) {
+      continue;
+    }
+    for( std::size_t i = 0; i < n; ++i ) {
+      const _replacement& r = pairs[i];
+      if( r.from_size != 0 && r.from_size <= size - pos && traits::eq( r.from[0], c ) &&
+          traits::compare( data + pos, r.from, r.from_size ) == 0 ) {
+        *match = &r;
+        return pos;
+      }
+    }
+  }
+  return npos;
+}
+
 template < class charT, class traits, class Alloc >
 const charT*
 cow::basic_string<charT,traits,Alloc>::c_str() const
@@ -1598,7 +1349,7 @@ cow::basic_string<charT,traits,Alloc>::c_str() const
   noexcept
 #endif
 {
-  return _get_string_ref().c_str();
+  return _get_data();
 }
 
 template < class charT, class traits, class Alloc >
@@ -1608,7 +1359,7 @@ cow::basic_string<charT,traits,Alloc>::data() const
   noexcept
 #endif
 {
-  return _get_string_ref().data();
+  return _get_data();
 }
 
 template < class charT, class traits, class Alloc >
@@ -1618,7 +1369,8 @@ cow::basic_string<charT,traits,Alloc>::get_allocator() const
   noexcept
 #endif
 {
-  COWSTRING_UNIMPLEMENTED();
+  // Buffers are allocated with default-constructed allocators.
+  return Alloc();
 }
 
 template < class charT, class traits, class Alloc >
@@ -1630,7 +1382,7 @@ cow::basic_string<charT,traits,Alloc>::find(
   noexcept
 #endif
 {
-  COWSTRING_UNIMPLEMENTED();
+  return _find( _get_data(), _get_size(), str.data(), pos, str.size() );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1642,7 +1394,7 @@ cow::basic_string<charT,traits,Alloc>::find(
   noexcept
 #endif
 {
-  return _get_string_ref().find( str._get_string_ref(), pos );
+  return _find( _get_data(), _get_size(), str._get_data(), pos, str._get_size() );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1651,7 +1403,7 @@ cow::basic_string<charT,traits,Alloc>::find(
   const charT* s,
   std::size_t pos) const
 {
-  return _get_string_ref().find( s, pos );
+  return _find( _get_data(), _get_size(), s, pos, traits::length(s) );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1661,7 +1413,7 @@ cow::basic_string<charT,traits,Alloc>::find(
   std::size_t pos,
   size_type n) const
 {
-  return _get_string_ref().find( s, pos, n );
+  return _find( _get_data(), _get_size(), s, pos, n );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1673,7 +1425,7 @@ cow::basic_string<charT,traits,Alloc>::find(
   noexcept
 #endif
 {
-  return _get_string_ref().find( c, pos );
+  return _find( _get_data(), _get_size(), &c, pos, 1 );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1685,7 +1437,7 @@ cow::basic_string<charT,traits,Alloc>::rfind(
   noexcept
 #endif
 {
-  return _get_string_ref().rfind( str, pos );
+  return _rfind( _get_data(), _get_size(), str.data(), pos, str.size() );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1697,7 +1449,7 @@ cow::basic_string<charT,traits,Alloc>::rfind(
   noexcept
 #endif
 {
-  return _get_string_ref().rfind( str._get_string_ref(), pos );
+  return _rfind( _get_data(), _get_size(), str._get_data(), pos, str._get_size() );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1706,7 +1458,7 @@ cow::basic_string<charT,traits,Alloc>::rfind(
   const charT* s,
   std::size_t pos) const
 {
-  return _get_string_ref().rfind( s, pos );
+  return _rfind( _get_data(), _get_size(), s, pos, traits::length(s) );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1716,7 +1468,7 @@ cow::basic_string<charT,traits,Alloc>::rfind(
   std::size_t pos,
   size_type n) const
 {
-  return _get_string_ref().rfind( s, pos, n );
+  return _rfind( _get_data(), _get_size(), s, pos, n );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1728,7 +1480,7 @@ cow::basic_string<charT,traits,Alloc>::rfind(
   noexcept
 #endif
 {
-  return _get_string_ref().rfind( c, pos );
+  return _rfind( _get_data(), _get_size(), &c, pos, 1 );
 }
 
 template < class charT, class traits, class Alloc >
@@ -1737,43 +1489,288 @@ cow::basic_string<charT,traits,Alloc>::substr(
   size_type pos,
   size_type count) const
 {
-  std::basic_string<charT,traits,Alloc> string_ref = _get_string_ref();
-  if(count == std::basic_string<charT,traits,Alloc>::npos) {
-    count = string_ref.size() - pos;
-  }
-  cow::basic_string<charT,traits,Alloc> result( &string_ref[pos], count );
+  cow::basic_string<charT,traits,Alloc> result( *this, pos, count );
   return result;
 }
 
+template < class charT, class traits, class Alloc >
+int
+cow::basic_string<charT,traits,Alloc>::compare(
+  const std::basic_string<charT,traits,Alloc>& str) const
+#if __cplusplus >= 201103L
+  noexcept
+#endif
+{
+  return _compare( _get_data(), _get_size(), str.data(), str.size() );
+}
+
+template < class charT, class traits, class Alloc >
+int
+cow::basic_string<charT,traits,Alloc>::compare(
+  const cow::basic_string<charT,traits,Alloc>& str) const
+#if __cplusplus >= 201103L
+  noexcept
+#endif
+{
+  // Most comparisons are decided by the keys, held in the handles.
+  const std::uint64_t lhs = _get_prefix();
+  const std::uint64_t rhs = str._get_prefix();
+  if( lhs != rhs ) {
+    return lhs < rhs ? -1 : 1;
+  }
+  const charT* data = _get_data();
+  const charT* str_data = str._get_data();
+  const std::size_t size = _get_size();
+  const std::size_t str_size = str._get_size();
+  if( data == str_data ) {
+    return size < str_size ? -1 : size > str_size ? 1 : 0;
+  }
+  // Equal keys of std::char_traits strings mean equal first 8 bytes, unless
+  // one string is shorter than that.
+  const std::size_t k = (_char_kernel_of<charT,traits>::value == _kernel_traits) ? 0 : 8 / sizeof(charT);
+  if( size >= k && str_size >= k ) {
+    return _compare( data + k, size - k, str_data + k, str_size - k );
+  }
+  return _compare( data, size, str_data, str_size );
+}
+
+template < class charT, class traits, class Alloc >
+int
+cow::basic_string<charT,traits,Alloc>::compare(
+  size_type pos,
+  size_type len,
+  const std::basic_string<charT,traits,Alloc>& str) const
+{
+  len = _clamp( *this, pos, len );
+  return _compare( _get_data() + pos, len, str.data(), str.size() );
+}
+
+template < class charT, class traits, class Alloc >
+int
+cow::basic_string<charT,traits,Alloc>::compare(
+  size_type pos,
+  size_type len,
+  const cow::basic_string<charT,traits,Alloc>& str) const
+{
+  len = _clamp( *this, pos, len );
+  return _compare( _get_data() + pos, len, str._get_data(), str._get_size() );
+}
+
+template < class charT, class traits, class Alloc >
+int
+cow::basic_string<charT,traits,Alloc>::compare(
+  size_type pos,
+  size_type len,
+  const std::basic_string<charT,traits,Alloc>& str,
+  size_type subpos,
+  size_type sublen) const
+{
+  len = _clamp( *this, pos, len );
+  sublen = _clamp( str, subpos, sublen );
+  return _compare( _get_data() + pos, len, str.data() + subpos, sublen );
+}
+
+template < class charT, class traits, class Alloc >
+int
+cow::basic_string<charT,traits,Alloc>::compare(
+  size_type pos,
+  size_type len,
+  const cow::basic_string<charT,traits,Alloc>& str,
+  size_type subpos,
+  size_type sublen) const
+{
+  len = _clamp( *this, pos, len );
+  sublen = _clamp( str, subpos, sublen );
+  return _compare( _get_data() + pos, len, str._get_data() + subpos, sublen );
+}
+
+template < class charT, class traits, class Alloc >
+int
+cow::basic_string<charT,traits,Alloc>::compare(
+  const charT* s) const
+{
+  return _compare( _get_data(), _get_size(), s, traits::length(s) );
+}
+
+template < class charT, class traits, class Alloc >
+int
+cow::basic_string<charT,traits,Alloc>::compare(
+  size_type pos,
+  size_type len,
+  const charT* s) const
+{
+  len = _clamp( *this, pos, len );
+  return _compare( _get_data() + pos, len, s, traits::length(s) );
+}
+
+template < class charT, class traits, class Alloc >
+int
+cow::basic_string<charT,traits,Alloc>::compare(
+  size_type pos,
+  size_type len,
+  const charT* s,
+  size_type n) const
+{
+  len = _clamp( *this, pos, len );
+  return _compare( _get_data() + pos, len, s, n );
+}
+
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc>::operator
 std::basic_string<charT,traits,Alloc>() const
 {
-  return _get_string_ref();
+  return std::basic_string<charT,traits,Alloc>( _get_data(), _get_size() );
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_string<charT,traits,Alloc>::_find(
+  const charT* data,
+  std::size_t size,
+  const charT* s,
+  std::size_t pos,
+  std::size_t n)
+{
+  if( pos > size || n > size - pos ) {
+    return npos;
+  }
+  if( n == 0 ) {
+    return pos;
+  }
+  const charT* const last = data + size - n + 1;
+  for( const charT* p = data + pos; p != last; ++p ) {
+    p = cow::_chars<charT,traits>::find( p, last - p, s[0] );
+    if( p == nullptr ) {
+      break;
+    }
+    if( traits::compare( p, s, n ) == 0 ) {
+      return p - data;
+    }
+  }
+  return npos;
+}
+
+template < class charT, class traits, class Alloc >
+std::size_t
+cow::basic_string<charT,traits,Alloc>::_rfind(
+  const charT* data,
+  std::size_t size,
+  const charT* s,
+  std::size_t pos,
+  std::size_t n)
+{
+  if( n > size ) {
+    return npos;
+  }
+  if( pos > size - n ) {
+    pos = size - n;
+  }
+  do {
+    if( traits::compare( data + pos, s, n ) == 0 ) {
+      return pos;
+    }
+  } while( pos-- != 0 );
+  return npos;
 }
 
 template < class charT, class traits, class Alloc >
-std::ostream& operator<< (
-  std::ostream& os,
+std::basic_ostream<charT,traits>& operator<< (
+  std::basic_ostream<charT,traits>& os,
   const cow::basic_string<charT,traits,Alloc>& str)
 {
-  os.write( &str[0], str.size() );
+  os.write( str.data(), str.size() );
   return os;
 }
 
+namespace cow {
+  // Where operator>> and cow::getline read: a writeable string in place, a
+  // read-only one into a new std::basic_string that it then adopts.
+  struct _stream_access {
+    template < class charT, class traits, class Alloc >
+    static std::basic_string<charT,traits,Alloc>* writeable(cow::basic_string<charT,traits,Alloc>& str) {
+      return str._is_readonly() ? nullptr : str.m_rw_string.get();
+    }
+
+    template < class charT, class traits, class Alloc >
+    static void adopt(cow::basic_string<charT,traits,Alloc>& str,
+                      std::basic_string<charT,traits,Alloc>&& read) {
+      str.m_rw_string.reset(new std::basic_string<charT,traits,Alloc>(std::move(read)));
+      str.m_ro_string.reset();
+      str.m_ro_length = 0;
+    }
+  };
+}
+
+template < class charT, class traits, class Alloc >
+std::basic_istream<charT,traits>& operator>> (
+  std::basic_istream<charT,traits>& is,
+  cow::basic_string<charT,traits,Alloc>& str)
+{
+  if( std::basic_string<charT,traits,Alloc>* in_place = cow::_stream_access::writeable(str) ) {
+    return is >> *in_place;
+  }
+  std::basic_string<charT,traits,Alloc> word;
+  is >> word;
+  // Nothing is extracted only if the sentry failed, and then 'str' is kept.
+  if( !word.empty() ) {
+    cow::_stream_access::adopt(str, std::move(word));
+  }
+  return is;
+}
+
+template < class charT, class traits, class Alloc >
+std::basic_istream<charT,traits>& cow::getline (
+  std::basic_istream<charT,traits>& is,
+  cow::basic_string<charT,traits,Alloc>& str,
+  charT delim)
+{
+  if( std::basic_string<charT,traits,Alloc>* in_place = cow::_stream_access::writeable(str) ) {
+    return std::getline( is, *in_place, delim );
+  }
+  // The sentry of getline fails only if 'is' isn't good, and then 'str' is
+  // kept.
+  const bool good = is.good();
+  std::basic_string<charT,traits,Alloc> line;
+  std::getline( is, line, delim );
+  if( good ) {
+    cow::_stream_access::adopt(str, std::move(line));
+  }
+  return is;
+}
+
+template < class charT, class traits, class Alloc >
+std::basic_istream<charT,traits>& cow::getline (
+  std::basic_istream<charT,traits>& is,
+  cow::basic_string<charT,traits,Alloc>& str)
+{
+  return cow::getline( is, str, is.widen('\n') );
+}
+
+// string (1.1)
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  const cow::basic_string<charT,traits,Alloc>& lhs,
+  const cow::basic_string<charT,traits,Alloc>& rhs)
+{
+  return cow::_concat<charT,traits,Alloc>( lhs.data(), lhs.size(), rhs.data(), rhs.size() );
+}
+
+// string (1.2)
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  const std::basic_string<charT,traits,Alloc>& lhs,
+  const cow::basic_string<charT,traits,Alloc>& rhs)
+{
+  return cow::_concat<charT,traits,Alloc>( lhs.data(), lhs.size(), rhs.data(), rhs.size() );
+}
+
 // string (1.3)
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc> operator+ (
   const cow::basic_string<charT,traits,Alloc>& lhs,
   const std::basic_string<charT,traits,Alloc>& rhs)
 {
-  const std::size_t lhsize = lhs.size();
-  const std::size_t rhsize = rhs.size();
-
-  cow::basic_string<charT,traits,Alloc> result( lhsize + rhsize, '\0' );
-  std::memcpy( &result[0],      &lhs[0], lhsize );
-  std::memcpy( &result[lhsize], &rhs[0], rhsize );
-  return result;
+  return cow::_concat<charT,traits,Alloc>( lhs.data(), lhs.size(), rhs.data(), rhs.size() );
 }
 
 // c-string (2)
@@ -1782,28 +1779,145 @@ cow::basic_string<charT,traits,Alloc> operator+ (
   const cow::basic_string<charT,traits,Alloc>& lhs,
   const charT*                                 rhs)
 {
-  const std::size_t lhsize = lhs.size();
-  const std::size_t rhsize = std::char_traits<charT>::length(rhs);
+  return cow::_concat<charT,traits,Alloc>( lhs.data(), lhs.size(), rhs, traits::length(rhs) );
+}
 
-  cow::basic_string<charT,traits,Alloc> result( lhsize + rhsize, '\0' );
-  std::memcpy( &result[0],      &lhs[0], lhsize );
-  std::memcpy( &result[lhsize], rhs,     rhsize );
-  return result;
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  const charT*                                 lhs,
+  const cow::basic_string<charT,traits,Alloc>& rhs)
+{
+  return cow::_concat<charT,traits,Alloc>( lhs, traits::length(lhs), rhs.data(), rhs.size() );
+}
+
+// character (3)
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  const cow::basic_string<charT,traits,Alloc>& lhs,
+  charT                                        rhs)
+{
+  return cow::_concat<charT,traits,Alloc>( lhs.data(), lhs.size(), &rhs, 1 );
 }
 
-#if __cplusplus >= 201103L
 template < class charT, class traits, class Alloc >
 cow::basic_string<charT,traits,Alloc> operator+ (
-        cow::basic_string<charT,traits,Alloc>&& lhs,
-  const std::basic_string<charT,traits,Alloc>&  rhs)
+  charT                                        lhs,
+  const cow::basic_string<charT,traits,Alloc>& rhs)
 {
-  const std::size_t lhsize = lhs.size();
-  const std::size_t rhsize = rhs.size();
+  return cow::_concat<charT,traits,Alloc>( &lhs, 1, rhs.data(), rhs.size() );
+}
 
-  cow::basic_string<charT,traits,Alloc> result( lhsize + rhsize, '\0' );
-  std::memcpy( &result[0],      &lhs[0], lhsize );
-  std::memcpy( &result[lhsize], &rhs[0], rhsize );
-  return result;
+#if __cplusplus >= 201103L // move semantics
+
+// string (1.1)
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  cow::basic_string<charT,traits,Alloc>&& lhs,
+  cow::basic_string<charT,traits,Alloc>&& rhs)
+{
+  return cow::_concat( std::move(lhs), rhs.data(), rhs.size() );
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  cow::basic_string<charT,traits,Alloc>&&      lhs,
+  const cow::basic_string<charT,traits,Alloc>& rhs)
+{
+  return cow::_concat( std::move(lhs), rhs.data(), rhs.size() );
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  const cow::basic_string<charT,traits,Alloc>& lhs,
+  cow::basic_string<charT,traits,Alloc>&&      rhs)
+{
+  return cow::_concat( lhs.data(), lhs.size(), std::move(rhs) );
+}
+
+// string (1.2)
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  std::basic_string<charT,traits,Alloc>&& lhs,
+  cow::basic_string<charT,traits,Alloc>&& rhs)
+{
+  lhs.append( rhs.data(), rhs.size() );
+  return cow::basic_string<charT,traits,Alloc>( std::move(lhs) );
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  std::basic_string<charT,traits,Alloc>&&      lhs,
+  const cow::basic_string<charT,traits,Alloc>& rhs)
+{
+  lhs.append( rhs.data(), rhs.size() );
+  return cow::basic_string<charT,traits,Alloc>( std::move(lhs) );
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  const std::basic_string<charT,traits,Alloc>& lhs,
+  cow::basic_string<charT,traits,Alloc>&&      rhs)
+{
+  return cow::_concat( lhs.data(), lhs.size(), std::move(rhs) );
+}
+
+// string (1.3)
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  cow::basic_string<charT,traits,Alloc>&& lhs,
+  std::basic_string<charT,traits,Alloc>&& rhs)
+{
+  return cow::_concat( std::move(lhs), rhs.data(), rhs.size() );
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  cow::basic_string<charT,traits,Alloc>&&      lhs,
+  const std::basic_string<charT,traits,Alloc>& rhs)
+{
+  return cow::_concat( std::move(lhs), rhs.data(), rhs.size() );
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  const cow::basic_string<charT,traits,Alloc>& lhs,
+  std::basic_string<charT,traits,Alloc>&&      rhs)
+{
+  rhs.insert( 0, lhs.data(), lhs.size() );
+  return cow::basic_string<charT,traits,Alloc>( std::move(rhs) );
+}
+
+// c-string (2)
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  cow::basic_string<charT,traits,Alloc>&& lhs,
+  const charT*                            rhs)
+{
+  return cow::_concat( std::move(lhs), rhs, traits::length(rhs) );
 }
-#endif
 
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  const charT*                            lhs,
+  cow::basic_string<charT,traits,Alloc>&& rhs)
+{
+  return cow::_concat( lhs, traits::length(lhs), std::move(rhs) );
+}
+
+// character (3)
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  cow::basic_string<charT,traits,Alloc>&& lhs,
+  charT                                   rhs)
+{
+  return cow::_concat( std::move(lhs), &rhs, 1 );
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> operator+ (
+  charT                                   lhs,
+  cow::basic_string<charT,traits,Alloc>&& rhs)
+{
+  return cow::_concat( &lhs, 1, std::move(rhs) );
+}
+#endif
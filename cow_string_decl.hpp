@@ -0,0 +1,1851 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwchar>
+#include <iosfwd>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+# define COWSTRING_HAVE_MMAP 1
+#else
+# define COWSTRING_HAVE_MMAP 0
+#endif
+
+// Define to 1 to count references to shared buffers with biased reference
+// counting (see _biased_ptr) instead of std::shared_ptr. Requires C++11.
+#if !defined(COWSTRING_BIASED_REFCOUNT)
+# define COWSTRING_BIASED_REFCOUNT 0
+#endif
+
+namespace cow {
+
+//----------------------------------------------------------------------------
+// Deferred reclamation of large buffers : cow::reclaim()
+//----------------------------------------------------------------------------
+// By default the thread that drops the last reference to a shared buffer
+// frees it. After set_reclaim_threshold(n), shared buffers of n bytes or more
+// (including the ones made before) are queued instead when they are dropped,
+// and freed by the next call to cow::reclaim() (e.g. from a maintenance
+// thread), keeping large free()s and munmap()s off latency-critical threads.
+struct reclaim_stats {
+  std::size_t queue_depth;      // buffers waiting to be freed
+  std::size_t queued_bytes;     // bytes waiting to be freed
+  std::size_t reclaimed_count;  // buffers freed by reclaim() so far
+  std::size_t reclaimed_bytes;  // bytes freed by reclaim() so far
+};
+
+// Pass std::size_t(-1) (the default) to free buffers immediately again.
+inline void          set_reclaim_threshold(std::size_t bytes);
+// Free all queued buffers on the calling thread. Returns the bytes freed.
+inline std::size_t   reclaim();
+inline reclaim_stats get_reclaim_stats();
+
+// Queue of buffers waiting for cow::reclaim(). Pushing is lock-free.
+class _reclaim_domain {
+public:
+  typedef void (*free_function)(void* ptr, std::size_t bytes);
+
+  static _reclaim_domain& get() {
+    static _reclaim_domain domain;
+    return domain;
+  }
+
+  bool defers(std::size_t bytes) const {
+    return bytes >= m_threshold.load(std::memory_order_relaxed);
+  }
+
+  // Queue 'ptr' to be freed by reclaim(). Returns false if the caller must
+  // free it now instead.
+  bool defer(free_function fn, void* ptr, std::size_t bytes) noexcept {
+    if( !defers(bytes) ) {
+      return false;
+    }
+    node* n = new (std::nothrow) node;
+    if( n == nullptr ) {
+      return false;
+    }
+    n->fn    = fn;
+    n->ptr   = ptr;
+    n->bytes = bytes;
+    n->next  = m_head.load(std::memory_order_relaxed);
+    while( !m_head.compare_exchange_weak(n->next, n, std::memory_order_release,
+                                         std::memory_order_relaxed) ) {
+    }
+    m_depth.fetch_add(1, std::memory_order_relaxed);
+    m_queued_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    return true;
+  }
+
+private:
+  struct node {
+    node*         next;
+    free_function fn;
+    void*         ptr;
+    std::size_t   bytes;
+  };
+
+  _reclaim_domain()
+  : m_threshold(std::size_t(-1)), m_head(nullptr), m_depth(0)
+  , m_queued_bytes(0), m_reclaimed_count(0), m_reclaimed_bytes(0)
+  {
+  }
+
+  std::atomic<std::size_t> m_threshold;
+  std::atomic<node*>       m_head;
+  std::atomic<std::size_t> m_depth;
+  std::atomic<std::size_t> m_queued_bytes;
+  std::atomic<std::size_t> m_reclaimed_count;
+  std::atomic<std::size_t> m_reclaimed_bytes;
+
+  friend void          cow::set_reclaim_threshold(std::size_t);
+  friend std::size_t   cow::reclaim();
+  friend reclaim_stats cow::get_reclaim_stats();
+};
+
+inline void set_reclaim_threshold(std::size_t bytes)
+{
+  _reclaim_domain::get().m_threshold.store(bytes, std::memory_order_relaxed);
+}
+
+inline std::size_t reclaim()
+{
+  _reclaim_domain& domain = _reclaim_domain::get();
+  _reclaim_domain::node* n = domain.m_head.exchange(nullptr, std::memory_order_acquire);
+  std::size_t count = 0;
+  std::size_t bytes = 0;
+  while( n != nullptr ) {
+    _reclaim_domain::node* next = n->next;
+    n->fn(n->ptr, n->bytes);
+    count += 1;
+    bytes += n->bytes;
+    delete n;
+    n = next;
+  }
+  domain.m_depth.fetch_sub(count, std::memory_order_relaxed);
+  domain.m_queued_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+  domain.m_reclaimed_count.fetch_add(count, std::memory_order_relaxed);
+  domain.m_reclaimed_bytes.fetch_add(bytes, std::memory_order_relaxed);
+  return bytes;
+}
+
+inline reclaim_stats get_reclaim_stats()
+{
+  const _reclaim_domain& domain = _reclaim_domain::get();
+  reclaim_stats stats;
+  stats.queue_depth     = domain.m_depth.load(std::memory_order_relaxed);
+  stats.queued_bytes    = domain.m_queued_bytes.load(std::memory_order_relaxed);
+  stats.reclaimed_count = domain.m_reclaimed_count.load(std::memory_order_relaxed);
+  stats.reclaimed_bytes = domain.m_reclaimed_bytes.load(std::memory_order_relaxed);
+  return stats;
+}
+
+
+#if COWSTRING_BIASED_REFCOUNT
+//----------------------------------------------------------------------------
+// Biased reference counting (COWSTRING_BIASED_REFCOUNT=1)
+//----------------------------------------------------------------------------
+// Shared buffers are counted with a plain counter while they are copied and
+// destroyed on the thread that created them (their owner), and with an atomic
+// counter on other threads. The owner merges its plain count into the atomic
+// one when the plain count drops to zero, when it exits, or when another
+// thread asks it to because the atomic count went negative.
+//
+// The owner handles these requests the next time it makes or drops a shared
+// buffer, or when it exits. Until then, a buffer whose last reference was
+// dropped by another thread stays allocated. A thread that hands strings to
+// others but then makes and drops none for a long time (e.g. while it waits
+// for work) can call cow::process_biased_requests() to free them.
+
+struct _biased_block;
+
+// Per-thread state of owners.
+struct _biased_thread {
+  _biased_thread() : refs(1), open(nullptr), requests(nullptr) {}
+  std::atomic<std::size_t>    refs;     // 1 for the thread + 1 per block
+  _biased_block*              open;     // owner only: blocks not merged yet
+  std::atomic<_biased_block*> requests; // blocks other threads want merged
+};
+
+struct _biased_block {
+  typedef void (*destroy_function)(_biased_block*);
+  _biased_thread*             owner;    // immutable
+  destroy_function            destroy;
+  std::size_t                 biased;   // owner only
+  // 'owner' while it counts with 'biased', _biased_nobody() once merged.
+  std::atomic<_biased_thread*> counting;
+  _biased_block*              prev;     // owner only: _biased_thread::open
+  _biased_block*              next;
+  std::atomic<std::intptr_t>  shared;   // (count << 1) | merged
+  std::atomic<bool>           requested;
+  _biased_block*              request_next;
+};
+
+inline _biased_thread*& _biased_current() {
+  static thread_local _biased_thread* current = nullptr;
+  return current;
+}
+
+// Never a current thread.
+inline _biased_thread* _biased_nobody() {
+  static _biased_thread nobody;
+  return &nobody;
+}
+
+// True if the calling thread counts 'b' with 'b->biased'.
+inline bool _biased_is_counting(const _biased_block* b) {
+  return b->counting.load(std::memory_order_relaxed) == _biased_current();
+}
+
+inline bool& _biased_exited() {
+  static thread_local bool exited = false;
+  return exited;
+}
+
+// Marks _biased_thread::requests once the owner has exited.
+inline _biased_block* _biased_closed_requests() {
+  static _biased_block sentinel;
+  return &sentinel;
+}
+
+inline void _biased_free(_biased_block* b) {
+  _biased_thread* owner = b->owner;
+  b->destroy(b);
+  if( owner != nullptr && owner->refs.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+    delete owner;
+  }
+}
+
+inline void _biased_release_shared(_biased_block* b) {
+  const std::intptr_t old = b->shared.fetch_sub(2, std::memory_order_acq_rel);
+  if( (old & 1) != 0 && (old >> 1) == 1 ) {
+    _biased_free(b);
+  }
+}
+
+// Owner only: merge the plain count. Returns true if 'b' must be freed.
+inline bool _biased_merge(_biased_block* b) {
+  b->counting.store(_biased_nobody(), std::memory_order_relaxed);
+  if( b->prev != nullptr ) {
+    b->prev->next = b->next;
+  } else {
+    b->owner->open = b->next;
+  }
+  if( b->next != nullptr ) {
+    b->next->prev = b->prev;
+  }
+  const std::intptr_t add = std::intptr_t(b->biased) * 2 + 1;
+  b->biased = 0;
+  return ((b->shared.fetch_add(add, std::memory_order_acq_rel) + add) >> 1) == 0;
+}
+
+// Owner only: merge the blocks other threads asked for, dropping the
+// reference each request holds.
+inline void _biased_process_requests(_biased_thread* t, _biased_block* replacement) {
+  _biased_block* b = t->requests.exchange(replacement, std::memory_order_acquire);
+  while( b != nullptr ) {
+    _biased_block* next = b->request_next;
+    if( _biased_is_counting(b) ) {
+      _biased_merge(b);
+    }
+    _biased_release_shared(b);
+    b = next;
+  }
+}
+
+inline void _biased_thread_exit() {
+  _biased_thread* t = _biased_current();
+  while( t->open != nullptr ) {
+    _biased_block* b = t->open;
+    if( _biased_merge(b) ) {
+      _biased_free(b);
+    }
+  }
+  _biased_process_requests(t, _biased_closed_requests());
+  _biased_current() = nullptr;
+  _biased_exited() = true;
+  if( t->refs.fetch_sub(1, std::memory_order_acq_rel) == 1 ) {
+    delete t;
+  }
+}
+
+struct _biased_exit_hook {
+  ~_biased_exit_hook() { _biased_thread_exit(); }
+};
+
+// Set up a new block with one reference, owned by the calling thread.
+inline void _biased_init(_biased_block* b, _biased_block::destroy_function destroy) {
+  b->destroy = destroy;
+  b->requested.store(false, std::memory_order_relaxed);
+  b->request_next = nullptr;
+  b->prev = nullptr;
+  b->next = nullptr;
+  _biased_thread*& t = _biased_current();
+  if( t == nullptr && !_biased_exited() ) {
+    t = new _biased_thread();
+    static thread_local _biased_exit_hook hook;
+    (void)hook;
+  }
+  if( t == nullptr ) {
+    // Created during thread exit: atomic counting only.
+    b->owner  = nullptr;
+    b->biased = 0;
+    b->counting.store(_biased_nobody(), std::memory_order_relaxed);
+    b->shared.store(2 + 1, std::memory_order_relaxed);
+    return;
+  }
+  _biased_process_requests(t, nullptr);
+  t->refs.fetch_add(1, std::memory_order_relaxed);
+  b->owner  = t;
+  b->biased = 1;
+  b->counting.store(t, std::memory_order_relaxed);
+  b->shared.store(0, std::memory_order_relaxed);
+  b->next = t->open;
+  if( t->open != nullptr ) {
+    t->open->prev = b;
+  }
+  t->open = b;
+}
+
+inline void _biased_acquire(_biased_block* b) {
+  if( _biased_is_counting(b) ) {
+    ++b->biased;
+  } else {
+    b->shared.fetch_add(2, std::memory_order_relaxed);
+  }
+}
+
+inline void _biased_release(_biased_block* b) {
+  if( _biased_is_counting(b) ) {
+    _biased_thread* owner = b->owner;
+    if( --b->biased == 0 && _biased_merge(b) ) {
+      _biased_free(b);
+    }
+    if( owner->requests.load(std::memory_order_relaxed) != nullptr ) {
+      _biased_process_requests(owner, nullptr);
+    }
+    return;
+  }
+  const std::intptr_t old = b->shared.load(std::memory_order_relaxed);
+  if( (old & 1) == 0 && (old >> 1) <= 0 &&
+      !b->requested.exchange(true, std::memory_order_relaxed) ) {
+    // The owner holds this reference in its plain count. Hand it over with
+    // a request to merge, rather than releasing it.
+    _biased_thread* owner = b->owner;
+    _biased_block* head = owner->requests.load(std::memory_order_relaxed);
+    while( head != _biased_closed_requests() ) {
+      b->request_next = head;
+      if( owner->requests.compare_exchange_weak(head, b, std::memory_order_release,
+                                                std::memory_order_relaxed) ) {
+        return;
+      }
+    }
+    // The owner has exited, so it merged 'b' already.
+  }
+  _biased_release_shared(b);
+}
+
+template < class T, class Deleter >
+struct _biased_deleter_block : _biased_block {
+  _biased_deleter_block(T* p, Deleter&& d) : ptr(p), deleter(std::move(d)) {}
+  T*      ptr;
+  Deleter deleter;
+  static void destroy(_biased_block* b) {
+    _biased_deleter_block* self = static_cast<_biased_deleter_block*>(b);
+    self->deleter(self->ptr);
+    delete self;
+  }
+};
+
+// The subset of std::shared_ptr used by cow::basic_string.
+template < class T >
+class _biased_ptr {
+public:
+  _biased_ptr() noexcept : m_ptr(nullptr), m_block(nullptr) {}
+
+  template < class Deleter >
+  _biased_ptr(T* p, Deleter d) : m_ptr(p), m_block(nullptr) {
+    _biased_deleter_block<T,Deleter>* b;
+    try {
+      b = new _biased_deleter_block<T,Deleter>(p, std::move(d));
+    } catch(...) {
+      d(p);
+      throw;
+    }
+    _biased_init(b, &_biased_deleter_block<T,Deleter>::destroy);
+    m_block = b;
+  }
+
+  // Aliasing constructor.
+  template < class U >
+  _biased_ptr(const _biased_ptr<U>& owner, T* p) noexcept : m_ptr(p), m_block(owner.m_block) {
+    if( m_block != nullptr ) {
+      _biased_acquire(m_block);
+    }
+  }
+
+  _biased_ptr(const _biased_ptr& other) noexcept : m_ptr(other.m_ptr), m_block(other.m_block) {
+    if( m_block != nullptr ) {
+      _biased_acquire(m_block);
+    }
+  }
+
+  _biased_ptr(_biased_ptr&& other) noexcept : m_ptr(other.m_ptr), m_block(other.m_block) {
+    other.m_ptr = nullptr;
+    other.m_block = nullptr;
+  }
+
+  ~_biased_ptr() {
+    if( m_block != nullptr ) {
+      _biased_release(m_block);
+    }
+  }
+
+  _biased_ptr& operator= (const _biased_ptr& other) noexcept {
+    _biased_ptr(other).swap(*this);
+    return *this;
+  }
+
+  _biased_ptr& operator= (_biased_ptr&& other) noexcept {
+    _biased_ptr(std::move(other)).swap(*this);
+    return *this;
+  }
+
+  void reset() noexcept {
+    _biased_ptr().swap(*this);
+  }
+
+  void swap(_biased_ptr& other) noexcept {
+    std::swap(m_ptr, other.m_ptr);
+    std::swap(m_block, other.m_block);
+  }
+
+  T* get() const noexcept { return m_ptr; }
+  T* operator-> () const noexcept { return m_ptr; }
+
+  // Approximate when other threads share the block.
+  long use_count() const noexcept {
+    if( m_block == nullptr ) {
+      return 0;
+    }
+    long count = long(m_block->shared.load(std::memory_order_relaxed) >> 1);
+    if( _biased_is_counting(m_block) ) {
+      count += long(m_block->biased);
+    }
+    return count < 1 ? 1 : count;
+  }
+
+  // Counterpart of std::get_deleter.
+  template < class Deleter >
+  Deleter* get_deleter() const noexcept {
+    if( m_block == nullptr || m_block->destroy != &_biased_deleter_block<T,Deleter>::destroy ) {
+      return nullptr;
+    }
+    return &static_cast<_biased_deleter_block<T,Deleter>*>(m_block)->deleter;
+  }
+
+private:
+  template < class U > friend class _biased_ptr;
+
+  T*             m_ptr;
+  _biased_block* m_block;
+};
+
+template < class Deleter, class T >
+Deleter* _get_deleter(const _biased_ptr<T>& p) noexcept {
+  return p.template get_deleter<Deleter>();
+}
+#endif
+
+// Merge the counts other threads asked the calling thread for, freeing the
+// buffers they dropped last (see above). Does nothing unless
+// COWSTRING_BIASED_REFCOUNT=1.
+inline void process_biased_requests() {
+#if COWSTRING_BIASED_REFCOUNT
+  _biased_thread* t = _biased_current();
+  if( t != nullptr && t->requests.load(std::memory_order_relaxed) != nullptr ) {
+    _biased_process_requests(t, nullptr);
+  }
+#endif
+}
+
+template < class Deleter, class T >
+Deleter* _get_deleter(const std::shared_ptr<T>& p) noexcept {
+  return std::get_deleter<Deleter>(p);
+}
+
+
+//----------------------------------------------------------------------------
+// Memory used by a string : cow::string::memory_footprint()
+//----------------------------------------------------------------------------
+// Sizes are in bytes. Heap bytes include the characters' NUL terminator.
+// The buffer's sizes are recorded when it is made, so suffixes sharing it
+// (see substr) report the whole buffer.
+enum buffer_kind {
+  buffer_writeable,  // the string's own std::basic_string
+  buffer_heap,       // a shared std::basic_string
+  buffer_mapped,     // a file mapping (see map_file)
+  buffer_immortal    // never freed: an immortal or frozen string
+};
+
+struct memory_footprint {
+  // Identifies the character buffer: strings sharing one have the same
+  // 'buffer' (the address of its NUL terminator).
+  const void* buffer;
+  buffer_kind kind;
+  std::size_t handle_bytes;   // the cow::basic_string itself
+  std::size_t control_bytes;  // reference count block, or the writeable std::basic_string (estimated)
+  std::size_t char_bytes;     // heap allocated for the characters; 0 if inline (SSO) or not on the heap
+  std::size_t mapped_bytes;   // the file mapping holding the characters, if buffer_mapped
+  std::size_t buffer_bytes;   // (size() + 1) * sizeof(charT) of the whole buffer
+  std::size_t used_bytes;     // (size() + 1) * sizeof(charT)
+  long        use_count;      // strings sharing 'buffer'; 0 if immortal
+  bool        shared;         // use_count > 1
+
+  // Allocated but unused character bytes (capacity beyond the buffer's size).
+  std::size_t wasted_bytes() const { return char_bytes > buffer_bytes ? char_bytes - buffer_bytes : 0; }
+};
+
+//----------------------------------------------------------------------------
+// Character search kernels : cow::_chars<charT,traits>
+//----------------------------------------------------------------------------
+// std::char_traits<char16_t> and <char32_t> search a character at a time, so
+// std::char_traits strings are searched by character width instead: 1-byte
+// characters with memchr, the type as wide as wchar_t (char32_t on Unix,
+// char16_t on Windows) with wmemchr, and the other one a 64-bit word at a
+// time (SWAR). Other traits keep traits::find.
+enum _char_kernel { _kernel_traits, _kernel_bytes, _kernel_wide, _kernel_swar };
+
+template < class charT, class traits >
+struct _char_kernel_of : std::integral_constant<int,
+  !std::is_same< traits, std::char_traits<charT> >::value ? _kernel_traits :
+  sizeof(charT) == 1                                     ? _kernel_bytes  :
+  sizeof(charT) == sizeof(wchar_t)                       ? _kernel_wide   :
+                                                           _kernel_swar> {};
+
+template < class charT, class traits, int kernel = _char_kernel_of<charT,traits>::value >
+struct _chars {
+  static const charT* find(const charT* s, std::size_t n, charT c) { return traits::find(s, n, c); }
+};
+
+template < class charT, class traits >
+struct _chars<charT, traits, _kernel_bytes> {
+  static const charT* find(const charT* s, std::size_t n, charT c) {
+    return n == 0 ? nullptr : static_cast<const charT*>(std::memchr(s, static_cast<unsigned char>(c), n));
+  }
+};
+
+template < class charT, class traits >
+struct _chars<charT, traits, _kernel_wide> {
+  static const charT* find(const charT* s, std::size_t n, charT c) {
+    return n == 0 ? nullptr : reinterpret_cast<const charT*>(
+      std::wmemchr(reinterpret_cast<const wchar_t*>(s), static_cast<wchar_t>(c), n));
+  }
+};
+
+template < class charT, class traits >
+struct _chars<charT, traits, _kernel_swar> {
+  static const charT* find(const charT* s, std::size_t n, charT c) {
+    const std::size_t k = 8 / sizeof(charT);  // characters per word
+    const std::uint64_t mask = ~UINT64_C(0) >> (64 - 8 * sizeof(charT));
+    // The lowest and highest bit of each character of a word.
+    const std::uint64_t low  = ~UINT64_C(0) / mask;
+    const std::uint64_t high = low << (8 * sizeof(charT) - 1);
+    const std::uint64_t pattern = low * (static_cast<std::uint64_t>(c) & mask);
+    std::size_t i = 0;
+    for( ; n - i >= k; i += k ) {
+      std::uint64_t word;
+      std::memcpy(&word, s + i, sizeof(word));
+      word ^= pattern;
+      // Non-zero iff a character of the word is 'c'.
+      if( ((word - low) & ~word & high) != 0 ) {
+        break;
+      }
+    }
+    for( ; i < n; ++i ) {
+      if( s[i] == c ) {
+        return s + i;
+      }
+    }
+    return nullptr;
+  }
+};
+
+//----------------------------------------------------------------------------
+// Ordering key : cow::_prefix_key<charT,traits>
+//----------------------------------------------------------------------------
+// The first 8 bytes of [s, s+n) as a big-endian integer, zero-padded, with
+// each character mapped to its unsigned order. Comparing the keys of two
+// strings of std::char_traits orders them like traits::compare does, except
+// for ties: strings whose keys differ compare like their keys, those whose
+// keys are equal must be compared. Other traits have no key (always 0).
+template < class charT, class traits >
+std::uint64_t _prefix_key(const charT* s, std::size_t n) {
+  if( _char_kernel_of<charT,traits>::value == _kernel_traits ) {
+    return 0;
+  }
+  const std::size_t k = 8 / sizeof(charT);  // characters in a key
+  const unsigned bits = 8 * sizeof(charT);
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if( sizeof(charT) == 1 && n >= 8 ) {
+    std::uint64_t word;
+    std::memcpy(&word, s, sizeof(word));
+    return __builtin_bswap64(word);
+  }
+#endif
+  // std::char_traits<char> compares as unsigned char; wider signed types
+  // (wchar_t) as signed, which flipping the sign bit maps to unsigned.
+  const std::uint64_t mask = ~UINT64_C(0) >> (64 - bits);
+  const std::uint64_t flip = (sizeof(charT) > 1 && charT(-1) < charT(0)) ? UINT64_C(1) << (bits - 1) : 0;
+  const std::size_t m = n < k ? n : k;
+  std::uint64_t key = 0;
+  for( std::size_t i = 0; i < k; ++i ) {
+    key <<= bits;
+    if( i < m ) {
+      key |= (static_cast<std::uint64_t>(s[i]) & mask) ^ flip;
+    }
+  }
+  return key;
+}
+
+// See cow_serializer.hpp
+template < class charT, class traits, class Alloc > class basic_deserializer;
+// See cow_utf.hpp
+struct _utf_cache;
+// See cow_sort.hpp
+struct _sort_access;
+// See operator>> and cow::getline
+struct _stream_access;
+// See cow_shm_string.hpp
+template < class charT, class traits, class Alloc > class basic_shm_string;
+
+
+//----------------------------------------------------------------------------
+// Template declaration : Copy-On-Write (COW) Basic String
+//----------------------------------------------------------------------------
+template < class charT,
+           class traits = std::char_traits<charT>,    // std::basic_string::traits_type
+           class Alloc = std::allocator<charT>        // std::basic_string::allocator_type
+           >
+class basic_string
+{
+public:
+  static const std::size_t npos = std::basic_string<charT,traits,Alloc>::npos;
+
+  typedef traits                                  traits_type;
+  typedef charT                                   value_type;
+  typedef Alloc                                   allocator_type;
+  typedef std::string::size_type                  size_type;
+  typedef charT*                                  iterator;
+  typedef const charT*                            const_iterator;
+  typedef std::reverse_iterator<iterator>         reverse_iterator;
+  typedef std::reverse_iterator<const_iterator>   const_reverse_iterator;
+
+
+  //----------------------------------------------------------------------------
+  // Construct string object
+  //----------------------------------------------------------------------------
+  // default (1)
+  basic_string ();
+  // copy (2)
+  basic_string (const cow::basic_string<charT,traits,Alloc>& str);
+  // copy (2.1)
+#if !defined(COWSTRING_IMPLICIT_STDSTRING_CTORS) && __cplusplus >= 201103L
+  explicit
+#endif
+  basic_string (const std::basic_string<charT,traits,Alloc>& str);
+  // substring (3)
+  basic_string (const cow::basic_string<charT,traits,Alloc>& str, std::size_t pos, std::size_t len = npos);
+  basic_string (const std::basic_string<charT,traits,Alloc>& str, std::size_t pos, std::size_t len = npos);
+  // from c-string (4)
+  basic_string (const charT* nul_terminated_c_str);
+  // from buffer (5)
+  basic_string (const charT* s, std::size_t n);
+  // fill (6)
+  basic_string (std::size_t n, charT c);
+  // range (7)
+  template <class InputIterator>
+  basic_string (InputIterator first, InputIterator last);
+#if __cplusplus >= 201103L
+  // initializer list (8)
+  basic_string (std::initializer_list<charT> il);
+  // move (9)
+  basic_string (cow::basic_string<charT,traits,Alloc>&& str) noexcept;
+  // move (9.1)
+# if !defined(COWSTRING_IMPLICIT_STDSTRING_CTORS) && __cplusplus >= 201103L
+  explicit
+# endif
+  basic_string (std::basic_string<charT,traits,Alloc>&& str);
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // String destructor
+  //----------------------------------------------------------------------------
+  ~basic_string();
+
+
+  //----------------------------------------------------------------------------
+  // Map a file into a read-only string : cow::string::map_file(..)
+  //----------------------------------------------------------------------------
+  // The characters are read straight from the page cache (no heap copy) until
+  // the first write, which copies them to the heap like any other shared
+  // string. The mapping is released when the last sharer is destroyed.
+  // Throws std::system_error if the file cannot be opened or mapped.
+  //
+  // The file must not be truncated or rewritten while it is mapped: reading
+  // past a truncated end raises SIGBUS, and rewriting it changes a string
+  // that is supposed to be read-only (whose comparisons rely on a cached
+  // copy of its first characters). Pipes, devices and files whose size isn't
+  // a multiple of sizeof(charT) are read with read_file instead.
+  static cow::basic_string<charT,traits,Alloc> map_file(const char* path);
+  static cow::basic_string<charT,traits,Alloc> map_file(const std::string& path);
+
+
+  //----------------------------------------------------------------------------
+  // Read a whole file or stream : cow::string::read_file(..), read_stream(..)
+  //----------------------------------------------------------------------------
+  // Reads straight into the new string's buffer: regular files in a single
+  // read sized from the file, streams and pipes in bulk reads (sgetn, fread)
+  // into a buffer that grows geometrically.
+  // read_file throws std::system_error if the file cannot be opened or read,
+  // or (EILSEQ) if it ends with a partial character.
+  // read_stream reads until the end of 'is' and sets its eofbit.
+  static cow::basic_string<charT,traits,Alloc> read_file(const char* path);
+  static cow::basic_string<charT,traits,Alloc> read_file(const std::string& path);
+  static cow::basic_string<charT,traits,Alloc> read_stream(std::basic_istream<charT,traits>& is);
+
+
+  //----------------------------------------------------------------------------
+  // Make the characters immortal : cow::string::freeze()
+  //----------------------------------------------------------------------------
+  // The buffer is never freed, and this string and all copies made from it
+  // afterwards no longer update a reference count. Copying frozen strings in
+  // a fork()ed child therefore doesn't dirty the pages shared with the parent.
+  // Writes still copy-on-write to a new (non-frozen) buffer.
+  void freeze();
+
+
+  //----------------------------------------------------------------------------
+  // Share characters in static storage : cow::string::from_static(..)
+  //----------------------------------------------------------------------------
+  // No allocation: the string points at 's', which must be NUL-terminated and
+  // live until the program exits (e.g. a string literal). Like frozen strings,
+  // copies don't update a reference count. See also cow::literals.
+  static cow::basic_string<charT,traits,Alloc> from_static(const charT* s);
+  static cow::basic_string<charT,traits,Alloc> from_static(const charT* s, std::size_t n);
+
+
+  //----------------------------------------------------------------------------
+  // String assignment : cow::string::operator=
+  //----------------------------------------------------------------------------
+  // string (1)
+  cow::basic_string<charT,traits,Alloc>& operator= (const std::basic_string<charT,traits,Alloc>& str);
+  // cow::string (1.1)
+  cow::basic_string<charT,traits,Alloc>& operator= (const cow::basic_string<charT,traits,Alloc>& str);
+  // c-string (2)
+  cow::basic_string<charT,traits,Alloc>& operator= (const charT* s);
+  // character (3)
+  cow::basic_string<charT,traits,Alloc>& operator= (charT c);
+#if __cplusplus >= 201103L
+  // initializer list (4)
+  cow::basic_string<charT,traits,Alloc>& operator= (std::initializer_list<charT> il);
+  // move (5)
+  cow::basic_string<charT,traits,Alloc>& operator= (std::basic_string<charT,traits,Alloc>&& str);
+  // move (5.1)
+  cow::basic_string<charT,traits,Alloc>& operator= (cow::basic_string<charT,traits,Alloc>&& str) noexcept;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Return iterator to beginning : cow::string::begin(..)
+  //----------------------------------------------------------------------------
+#if __cplusplus >= 201103L
+        iterator begin() noexcept;
+  const_iterator begin() const noexcept;
+#else
+        iterator begin();
+  const_iterator begin() const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Return iterator to end : cow::string::end(..)
+  //----------------------------------------------------------------------------
+#if __cplusplus >= 201103L
+        iterator end() noexcept;
+  const_iterator end() const noexcept;
+#else
+        iterator end();
+  const_iterator end() const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Return reverse iterator to reverse beginning : cow::string::rbegin(..)
+  //----------------------------------------------------------------------------
+#if __cplusplus >= 201103L
+        reverse_iterator rbegin() noexcept;
+  const_reverse_iterator rbegin() const noexcept;
+#else
+        reverse_iterator rbegin();
+  const_reverse_iterator rbegin() const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Return reverse iterator to reverse end : cow::string::rend(..)
+  //----------------------------------------------------------------------------
+#if __cplusplus >= 201103L
+        reverse_iterator rend() noexcept;
+  const_reverse_iterator rend() const noexcept;
+#else
+        reverse_iterator rend();
+  const_reverse_iterator rend() const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // C++11 explicit const_iterator functions.
+  //----------------------------------------------------------------------------
+#if __cplusplus >= 201103L
+  const_iterator         cbegin()  const noexcept;
+  const_iterator         cend()    const noexcept;
+  const_reverse_iterator crbegin() const noexcept;
+  const_reverse_iterator crend()   const noexcept;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Return length of string
+  //----------------------------------------------------------------------------
+#if __cplusplus >= 201103L
+  std::size_t size() const noexcept;
+  std::size_t length() const noexcept;
+  std::size_t max_size() const noexcept;
+  std::size_t capacity() const noexcept;
+  bool        empty() const noexcept;
+#else
+  std::size_t size() const;
+  std::size_t length() const;
+  std::size_t max_size() const;
+  std::size_t capacity() const;
+  bool        empty() const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Memory used : cow::string::memory_footprint()
+  //----------------------------------------------------------------------------
+  // A shared buffer is counted at the capacity of the std::basic_string that
+  // owns it, and file mappings apart from the heap. Immortal buffers (see
+  // freeze() and from_static()) count as no heap.
+  // See also cow::memory_report(..) in cow_memory.hpp.
+  cow::memory_footprint memory_footprint() const;
+
+
+  //----------------------------------------------------------------------------
+  // Change string size
+  //----------------------------------------------------------------------------
+  void resize(std::size_t n);
+  void resize(std::size_t n, charT c);
+  void reserve(std::size_t n = 0);
+#if __cplusplus >= 201103L
+  void clear() noexcept;
+  void shrink_to_fit();
+#else
+  void clear();
+#endif
+
+  //----------------------------------------------------------------------------
+  // Get character of string
+  //----------------------------------------------------------------------------
+  // TODO(olegat) should return a class that override write-operators.
+        charT& operator[] (std::size_t pos);
+  const charT& operator[] (std::size_t pos) const;
+        charT& at (std::size_t pos);
+  const charT& at (std::size_t pos) const;
+#if __cplusplus >= 201103L
+        charT& back ();
+  const charT& back () const;
+        charT& front();
+  const charT& front() const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Append to string : cow::string::operator+=
+  //----------------------------------------------------------------------------
+  // string (1)
+  cow::basic_string<charT,traits,Alloc>& operator+= (const cow::basic_string<charT,traits,Alloc>& str);
+  cow::basic_string<charT,traits,Alloc>& operator+= (const std::basic_string<charT,traits,Alloc>& str);
+  // c-string (2)
+  cow::basic_string<charT,traits,Alloc>& operator+= (const charT* s);
+  // character (3)
+  cow::basic_string<charT,traits,Alloc>& operator+= (charT c);
+#if __cplusplus >= 201103L
+  // initializer list (4)
+  cow::basic_string<charT,traits,Alloc>& operator+= (std::initializer_list<charT> il);
+#endif
+
+  // string (1)
+  cow::basic_string<charT,traits,Alloc>& append (const cow::basic_string<charT,traits,Alloc>& str);
+  // substring (2)
+  cow::basic_string<charT,traits,Alloc>& append (const cow::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen);
+  // c-string (3)
+  cow::basic_string<charT,traits,Alloc>& append (const charT* s);
+  // buffer (4)
+  cow::basic_string<charT,traits,Alloc>& append (const charT* s, std::size_t n);
+  // fill (5)
+  cow::basic_string<charT,traits,Alloc>& append (std::size_t n, charT c);
+  // range (6)
+  template <class InputIterator>
+  cow::basic_string<charT,traits,Alloc>& append (InputIterator first, InputIterator last);
+#if __cplusplus >= 201103L
+  // initializer list(7)
+  cow::basic_string<charT,traits,Alloc>& append (std::initializer_list<charT> il);
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Modifiers
+  //----------------------------------------------------------------------------
+  void push_back(charT c);
+#if __cplusplus >= 201103L
+  void swap(cow::basic_string<charT,traits,Alloc>& str) noexcept;
+#else
+  void swap(cow::basic_string<charT,traits,Alloc>& str);
+#endif
+  void swap(std::basic_string<charT,traits,Alloc>& str);
+#if __cplusplus >= 201103L
+  void pop_back();
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Assign content to string : cow::string::assign(..)
+  //----------------------------------------------------------------------------
+  // string (1)
+  cow::basic_string<charT,traits,Alloc>& assign (const cow::basic_string<charT,traits,Alloc>& str);
+  // substring (2)
+  cow::basic_string<charT,traits,Alloc>& assign (const cow::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen = npos);
+  // c-string (3)
+  cow::basic_string<charT,traits,Alloc>& assign (const charT* s);
+  // buffer (4)
+  cow::basic_string<charT,traits,Alloc>& assign (const charT* s, std::size_t n);
+  // fill (5)
+  cow::basic_string<charT,traits,Alloc>& assign (std::size_t n, charT c);
+  // range (6)
+  template <class InputIterator>
+  cow::basic_string<charT,traits,Alloc>& assign (InputIterator first, InputIterator last);
+#if __cplusplus >= 201103L
+  // initializer list(7)
+  cow::basic_string<charT,traits,Alloc>& assign (std::initializer_list<charT> il);
+  // move (8)
+  cow::basic_string<charT,traits,Alloc>& assign (cow::basic_string<charT,traits,Alloc>&& str) noexcept;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Insert into string : cow::string::insert(..)
+  //----------------------------------------------------------------------------
+  // string (1)
+  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const std::basic_string<charT,traits,Alloc>& str);
+  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const cow::basic_string<charT,traits,Alloc>& str);
+  // substring (2)
+#if __cplusplus >= 201402L
+  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const std::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen = npos);
+  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const cow::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen = npos);
+#endif
+  // c-string (3)
+  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const charT* s);
+  // buffer (4)
+  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos, const charT* s, std::size_t n);
+  // fill (5)
+  cow::basic_string<charT,traits,Alloc>& insert (std::size_t pos,   std::size_t n, charT c);
+  iterator                               insert (const_iterator p, std::size_t n, charT c);
+  // single character (6)
+  iterator                               insert (const_iterator p, charT c);
+#if __cplusplus >= 201103L
+  // range (7)
+  template <class InputIterator>
+  iterator                               insert (iterator p, InputIterator first, InputIterator last);
+  // initializer list (8)
+  cow::basic_string<charT,traits,Alloc>& insert (const_iterator p, std::initializer_list<charT> il);
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Erase characters from string : cow::string::erase(..)
+  //----------------------------------------------------------------------------
+  // sequence (1)
+#if __cplusplus >= 201402L
+  cow::basic_string<charT,traits,Alloc>& erase (std::size_t pos = 0, std::size_t len = npos);
+#endif
+#if __cplusplus >= 201103L
+  // character (2)
+  iterator erase (const_iterator p);
+  // range (3)
+  iterator erase (const_iterator first, const_iterator last);
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Replace portion of string : cow::string::replace(..)
+  //----------------------------------------------------------------------------
+  // string (1)
+  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const std::basic_string<charT,traits,Alloc>& str);
+  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const cow::basic_string<charT,traits,Alloc>& str);
+  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, const std::basic_string<charT,traits,Alloc>& str);
+  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, const cow::basic_string<charT,traits,Alloc>& str);
+  // substring (2)
+#if __cplusplus >= 201402L
+  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const std::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen = npos);
+  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const cow::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen = npos);
+#else
+  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const std::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen);
+  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const cow::basic_string<charT,traits,Alloc>& str, std::size_t subpos, std::size_t sublen);
+#endif
+  // c-string (3)
+  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const charT* s);
+  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, const charT* s);
+  // buffer (4)
+  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   const charT* s, std::size_t n);
+  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, const charT* s, std::size_t n);
+  // fill (5)
+  cow::basic_string<charT,traits,Alloc>& replace (std::size_t pos,   std::size_t len,   std::size_t n, charT c);
+  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, std::size_t n, charT c);
+  // range (6)
+  template <class InputIterator>
+  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, InputIterator first, InputIterator last);
+#if __cplusplus >= 201103L
+  // initializer list (7)
+  cow::basic_string<charT,traits,Alloc>& replace (const_iterator i1, const_iterator i2, std::initializer_list<charT> il);
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Replace every occurrence : cow::string::replace_all(..)
+  //----------------------------------------------------------------------------
+  // Replaces the non-overlapping occurrences of 'from', left to right, in a
+  // single pass: the new size is counted first, then the result is written
+  // into one allocation. If nothing matches (or 'from' is empty), the string
+  // is left as it is and a shared buffer stays shared.
+  // pair (1)
+  cow::basic_string<charT,traits,Alloc>& replace_all (const cow::basic_string<charT,traits,Alloc>& from, const cow::basic_string<charT,traits,Alloc>& to);
+  cow::basic_string<charT,traits,Alloc>& replace_all (const charT* from, const charT* to);
+#if __cplusplus >= 201103L
+  // pairs (2): at each position, the first pair whose 'from' matches is used.
+  cow::basic_string<charT,traits,Alloc>& replace_all (std::initializer_list< std::pair<const charT*, const charT*> > pairs);
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Get C-string equivalent : cow::string::c_str()
+  //----------------------------------------------------------------------------
+#if __cplusplus >= 201103L
+  const charT* c_str() const noexcept;
+  const charT* data()  const noexcept;
+  Alloc get_allocator() const noexcept;
+#else
+  const charT* c_str() const;
+  const charT* data()  const;
+  Alloc get_allocator() const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Copy sequence of characters from string : cow::string::copy(..)
+  //----------------------------------------------------------------------------
+  size_type copy(charT* s, size_type len, size_type pos = 0) const;
+
+
+  //----------------------------------------------------------------------------
+  // Find content in string : cow::string::find(..)
+  //----------------------------------------------------------------------------
+  // string (1)
+#if __cplusplus >= 201103L
+  std::size_t find (const std::basic_string<charT,traits,Alloc>& str, std::size_t pos = 0) const noexcept;
+  std::size_t find (const cow::basic_string<charT,traits,Alloc>& str, std::size_t pos = 0) const noexcept;
+#else
+  std::size_t find (const std::basic_string<charT,traits,Alloc>& str, std::size_t pos = 0) const;
+  std::size_t find (const cow::basic_string<charT,traits,Alloc>& str, std::size_t pos = 0) const;
+#endif
+  // c-string (2)
+  std::size_t find (const charT* s, std::size_t pos = 0) const;
+  // buffer (3)
+  std::size_t find (const charT* s, std::size_t pos, size_type n) const;
+  // character (4)
+#if __cplusplus >= 201103L
+  std::size_t find (charT c, std::size_t pos = 0) const noexcept;
+#else
+  std::size_t find (charT c, std::size_t pos = 0) const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Find last occurrence in string : cow::string::rfind(..)
+  //----------------------------------------------------------------------------
+  // string (1)
+#if __cplusplus >= 201103L
+  std::size_t rfind (const std::basic_string<charT,traits,Alloc>& str, std::size_t pos = npos) const noexcept;
+  std::size_t rfind (const cow::basic_string<charT,traits,Alloc>& str, std::size_t pos = npos) const noexcept;
+#else
+  std::size_t rfind (const std::basic_string<charT,traits,Alloc>& str, std::size_t pos = npos) const;
+  std::size_t rfind (const cow::basic_string<charT,traits,Alloc>& str, std::size_t pos = npos) const;
+#endif
+  // c-string (2)
+  std::size_t rfind (const charT* s, std::size_t pos = 0) const;
+  // buffer (3)
+  std::size_t rfind (const charT* s, std::size_t pos, size_type n) const;
+  // character (4)
+#if __cplusplus >= 201103L
+  std::size_t rfind (charT c, std::size_t pos = 0) const noexcept;
+#else
+  std::size_t rfind (charT c, std::size_t pos = 0) const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Find character in string : cow::string::find_first_of(..)
+  //----------------------------------------------------------------------------
+  // string (1)
+#if __cplusplus >= 201103L
+  size_type find_first_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
+  size_type find_first_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
+#else
+  size_type find_first_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
+  size_type find_first_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
+#endif
+  // c-string (2)
+  size_type find_first_of (const charT* s, size_type pos = 0) const;
+  // buffer (3)
+  size_type find_first_of (const charT* s, size_type pos, size_type n) const;
+  // character (4)
+#if __cplusplus >= 201103L
+  size_type find_first_of (charT c, size_type pos = 0) const noexcept;
+#else
+  size_type find_first_of (charT c, size_type pos = 0) const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Find character in string from the end : cow::string::find_last_of(..)
+  //----------------------------------------------------------------------------
+  // string (1)
+#if __cplusplus >= 201103L
+  size_type find_last_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
+  size_type find_last_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
+#else
+  size_type find_last_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
+  size_type find_last_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
+#endif
+  // c-string (2)
+  size_type find_last_of (const charT* s, size_type pos = 0) const;
+  // buffer (3)
+  size_type find_last_of (const charT* s, size_type pos, size_type n) const;
+  // character (4)
+#if __cplusplus >= 201103L
+  size_type find_last_of (charT c, size_type pos = 0) const noexcept;
+#else
+  size_type find_last_of (charT c, size_type pos = 0) const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Find non-matching character in string string : cow::string::find_first_not_of(..)
+  //----------------------------------------------------------------------------
+  // string (1)
+#if __cplusplus >= 201103L
+  size_type find_first_not_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
+  size_type find_first_not_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
+#else
+  size_type find_first_not_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
+  size_type find_first_not_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
+#endif
+  // c-string (2)
+  size_type find_first_not_of (const charT* s, size_type pos = 0) const;
+  // buffer (3)
+  size_type find_first_not_of (const charT* s, size_type pos, size_type n) const;
+  // character (4)
+#if __cplusplus >= 201103L
+  size_type find_first_not_of (charT c, size_type pos = 0) const noexcept;
+#else
+  size_type find_first_not_of (charT c, size_type pos = 0) const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Find non-matching character in string from the end : cow::string::find_last_not_of(..)
+  //----------------------------------------------------------------------------
+  // string (1)
+#if __cplusplus >= 201103L
+  size_type find_last_not_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
+  size_type find_last_not_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const noexcept;
+#else
+  size_type find_last_not_of (const std::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
+  size_type find_last_not_of (const cow::basic_string<charT,traits,Alloc>& str, size_type pos = 0) const;
+#endif
+  // c-string (2)
+  size_type find_last_not_of (const charT* s, size_type pos = 0) const;
+  // buffer (3)
+  size_type find_last_not_of (const charT* s, size_type pos, size_type n) const;
+  // character (4)
+#if __cplusplus >= 201103L
+  size_type find_last_not_of (charT c, size_type pos = 0) const noexcept;
+#else
+  size_type find_last_not_of (charT c, size_type pos = 0) const;
+#endif
+
+
+  //----------------------------------------------------------------------------
+  // Returns a substring : cow::string::substr(..)
+  //----------------------------------------------------------------------------
+  // A suffix of a shared string shares its buffer (no copy).
+#if __cplusplus > 201703L
+  constexpr
+#endif
+  cow::basic_string<charT,traits,Alloc> substr( size_type pos = 0, size_type count = npos ) const;
+
+
+  //----------------------------------------------------------------------------
+  // Compare strings : cow::string::compare(..)
+  //----------------------------------------------------------------------------
+  // Shared strings keep their first 8 bytes in the handle, as an integer: two
+  // of them are usually ordered by comparing the integers, without reading
+  // their characters. (Not for custom traits.)
+  // string (1)
+#if __cplusplus >= 201103L
+  int compare (const std::basic_string<charT,traits,Alloc>& str) const noexcept;
+  int compare (const cow::basic_string<charT,traits,Alloc>& str) const noexcept;
+#else
+  int compare (const std::basic_string<charT,traits,Alloc>& str) const;
+  int compare (const cow::basic_string<charT,traits,Alloc>& str) const;
+#endif
+  // substrings (2)
+  int compare (size_type pos, size_type len, const std::basic_string<charT,traits,Alloc>& str) const;
+  int compare (size_type pos, size_type len, const cow::basic_string<charT,traits,Alloc>& str) const;
+#if __cplusplus >= 201402L
+  int compare (size_type pos, size_type len, const std::basic_string<charT,traits,Alloc>& str, size_type subpos, size_type sublen = npos) const;
+  int compare (size_type pos, size_type len, const cow::basic_string<charT,traits,Alloc>& str, size_type subpos, size_type sublen = npos) const;
+#else
+  int compare (size_type pos, size_type len, const std::basic_string<charT,traits,Alloc>& str, size_type subpos, size_type sublen) const;
+  int compare (size_type pos, size_type len, const cow::basic_string<charT,traits,Alloc>& str, size_type subpos, size_type sublen) const;
+#endif
+  // c-string (3)
+  int compare (const charT* s) const;
+  int compare (size_type pos, size_type len, const charT* s) const;
+  // buffer (4)
+  int compare (size_type pos, size_type len, const charT* s, size_type n) const;
+  //----------------------------------------------------------------------------
+
+  //----------------------------------------------------------------------------
+  // Implicit std::basic_string conversion
+  // (necessary to add fake overloads for std::basic_string)
+  // Example: std::string s = cow::string("Hello world")
+  //----------------------------------------------------------------------------
+#if ! defined(COWSTRING_IMPLICIT_STDSTRING_OPERATOR) && __cplusplus >= 201103L
+  explicit
+#endif
+  operator std::basic_string<charT,traits,Alloc>()  const;
+
+private:
+  // Shares a loaded image with the strings read from it.
+  template < class C, class T, class A > friend class cow::basic_deserializer;
+  // Caches conversions of read-only buffers.
+  friend struct cow::_utf_cache;
+  // Reads the ordering keys.
+  friend struct cow::_sort_access;
+  // Reads streams into the writeable string.
+  friend struct cow::_stream_access;
+  // Searches and compares segment characters like strings do.
+  template < class C, class T, class A > friend class cow::basic_shm_string;
+
+#if COWSTRING_BIASED_REFCOUNT
+  typedef cow::_biased_ptr<const charT> _shared_chars;
+#else
+  typedef std::shared_ptr<const charT>  _shared_chars;
+#endif
+
+  bool _is_readonly() const {
+    return m_ro_string.get() != nullptr;
+  }
+
+  // Immortal buffers have no owner, so copying them doesn't touch a refcount.
+  bool _is_immortal() const {
+    return _is_readonly() && m_ro_string.use_count() == 0;
+  }
+
+  // Share 'data' read-only without owning it. 'data' must outlive the program.
+  void _set_immortal(const charT* data, std::size_t length) {
+    _set_readonly(_shared_chars(_shared_chars(), data), length);
+  }
+
+  // Share the process-wide empty string: no allocation.
+  void _set_empty() {
+    static const charT empty = charT();
+    _set_immortal(&empty, 0);
+  }
+
+  std::basic_string<charT,traits,Alloc>& _get_writeable() {
+    if( _is_readonly() ) {
+      // Copy-On-Write:
+      m_rw_string.reset(new std::basic_string<charT,traits,Alloc>(m_ro_string.get(), m_ro_length));
+      m_ro_string.reset();
+      m_ro_length = 0;
+    }
+    return *m_rw_string.get();
+  }
+
+  const charT* _get_data() const {
+    return _is_readonly() ? m_ro_string.get() : m_rw_string->data();
+  }
+
+  std::size_t _get_size() const {
+    return _is_readonly() ? m_ro_length : m_rw_string->size();
+  }
+
+  // The ordering key of the characters (see _prefix_key): stored for shared
+  // strings, whose characters can't change, computed for writeable ones.
+  std::uint64_t _get_prefix() const {
+    return _is_readonly() ? m_ro_prefix
+                          : cow::_prefix_key<charT,traits>(m_rw_string->data(), m_rw_string->size());
+  }
+
+  // Share 'data' (which must be followed by a NUL character) read-only.
+  // 'data' owns whatever keeps the characters alive.
+  void _set_readonly(const _shared_chars& data, std::size_t length) {
+    m_rw_string.reset();
+    m_ro_string = data;
+    m_ro_length = length;
+    m_ro_prefix = cow::_prefix_key<charT,traits>(data.get(), length);
+  }
+
+  // Share the characters of a heap-allocated std::basic_string read-only.
+  void _set_readonly(std::basic_string<charT,traits,Alloc>&& str) {
+    if( str.empty() ) {
+      _set_empty();
+      return;
+    }
+    // The deleter holds the string, in the same allocation as the count
+    // (like make_shared), where memory_footprint() can find it.
+    const _shared_chars block(static_cast<const charT*>(nullptr), _heap_owner{std::move(str)});
+    const std::basic_string<charT,traits,Alloc>& owner = cow::_get_deleter<_heap_owner>(block)->str;
+    _set_readonly(_shared_chars(block, owner.data()), owner.size());
+  }
+
+  // The first 'size' characters of 'str', given up front to reads that
+  // overallocate. Gives back the spare capacity if it is most of 'str'.
+  static cow::basic_string<charT,traits,Alloc> _adopt(std::basic_string<charT,traits,Alloc>&& str,
+                                                      std::size_t size) {
+    str.resize(size);
+    if( str.capacity() / 2 > size ) {
+      str.shrink_to_fit();
+    }
+    return cow::basic_string<charT,traits,Alloc>(std::move(str));
+  }
+
+  static std::size_t _get_bytes(const std::basic_string<charT,traits,Alloc>& str) {
+    return (str.capacity() + 1) * sizeof(charT);
+  }
+
+  // Estimated size of the reference count block of a buffer freed by 'Deleter'.
+  template < class Deleter >
+  static std::size_t _get_control_bytes() {
+#if COWSTRING_BIASED_REFCOUNT
+    return sizeof(cow::_biased_deleter_block<const charT,Deleter>);
+#else
+    // A vtable pointer, the two counts, the pointer and the deleter.
+    return 2 * sizeof(void*) + sizeof(const charT*) + sizeof(Deleter);
+#endif
+  }
+
+  // Owner of shared buffers, freed with the reference count. Large ones
+  // are handed to cow::reclaim() instead (see set_reclaim_threshold).
+  struct _heap_owner {
+    std::basic_string<charT,traits,Alloc> str;
+    void operator() (const charT*) noexcept {
+      const std::size_t bytes = _get_bytes(str);
+      if( !cow::_reclaim_domain::get().defers(bytes) ) {
+        return;
+      }
+      // Moving the string keeps its characters where they are.
+      std::basic_string<charT,traits,Alloc>* queued =
+        new (std::nothrow) std::basic_string<charT,traits,Alloc>(std::move(str));
+      if( queued != nullptr && !cow::_reclaim_domain::get().defer(&_delete, queued, bytes) ) {
+        delete queued;
+      }
+    }
+    static void _delete(void* owner, std::size_t) {
+      delete static_cast<std::basic_string<charT,traits,Alloc>*>(owner);
+    }
+  };
+
+  cow::basic_string<charT,traits,Alloc>& _copy(const cow::basic_string<charT,traits,Alloc>& lhs) {
+    if( lhs._is_readonly() ) {
+      // Shares the key too, without reading the characters.
+      m_rw_string.reset();
+      m_ro_string = lhs.m_ro_string;
+      m_ro_length = lhs.m_ro_length;
+      m_ro_prefix = lhs.m_ro_prefix;
+    } else if( this != &lhs ) {
+      _set_readonly(std::basic_string<charT,traits,Alloc>(*lhs.m_rw_string.get()));
+    }
+    return *this;
+  }
+
+  // Length of the substring [subpos, subpos+sublen) of 'str', clamped to its
+  // end like std::basic_string does.
+  template < class String >
+  static std::size_t _clamp(const String& str, std::size_t subpos, std::size_t sublen) {
+    const std::size_t size = str.size();
+    if( subpos > size ) {
+      throw std::out_of_range("cow::basic_string");
+    }
+    return sublen < size - subpos ? sublen : size - subpos;
+  }
+
+  // Convert a std::basic_string iterator of the writeable string to an iterator.
+  static iterator _to_iterator(std::basic_string<charT,traits,Alloc>& str,
+                               typename std::basic_string<charT,traits,Alloc>::iterator it) {
+    return &str[0] + (it - str.begin());
+  }
+
+  // Like compare(), for [lhs, lhs+lhsize) and [rhs, rhs+rhsize).
+  static int _compare(const charT* lhs, std::size_t lhsize, const charT* rhs, std::size_t rhsize) {
+    const int result = traits::compare(lhs, rhs, lhsize < rhsize ? lhsize : rhsize);
+    if( result != 0 ) {
+      return result;
+    }
+    return lhsize < rhsize ? -1 : lhsize > rhsize ? 1 : 0;
+  }
+
+  static std::size_t _find(const charT* data, std::size_t size,
+                           const charT* s, std::size_t pos, std::size_t n);
+  static std::size_t _rfind(const charT* data, std::size_t size,
+                            const charT* s, std::size_t pos, std::size_t n);
+
+  struct _replacement {
+    const charT* from;
+    std::size_t  from_size;
+    const charT* to;
+    std::size_t  to_size;
+  };
+  cow::basic_string<charT,traits,Alloc>& _replace_all(const _replacement* pairs, std::size_t n);
+  // Position of the next match at or after 'pos' (or npos), and its pair.
+  static std::size_t _find_any(const charT* data, std::size_t size, std::size_t pos,
+                               const _replacement* pairs, std::size_t n,
+                               const bool* first_chars, const _replacement** match);
+
+  /* Read-only characters, copied-on-write to m_rw_string. The pointer shares
+     ownership of the buffer holding them: usually a heap std::basic_string,
+     but possibly a file mapping (see map_file). */
+  _shared_chars                  m_ro_string;
+  std::size_t                    m_ro_length;
+  /* _prefix_key of the read-only characters: decides most comparisons
+     without reading them. */
+  std::uint64_t                  m_ro_prefix;
+
+  /* Read-write string, moved to m_ro_string when this is copied */
+  std::unique_ptr< std::basic_string<charT,traits,Alloc> > m_rw_string;
+
+}; // template class basic_srtring
+
+
+//------------------------------------------------------------------------------
+// Class instantiations
+//------------------------------------------------------------------------------
+typedef cow::basic_string<char>      string;
+typedef cow::basic_string<char16_t>  u16string;
+typedef cow::basic_string<char32_t>  u32string;
+typedef cow::basic_string<wchar_t>   wstring;
+
+
+#if __cplusplus >= 201103L
+//------------------------------------------------------------------------------
+// String literals : "GET"_cow
+//------------------------------------------------------------------------------
+inline namespace literals {
+  inline cow::string    operator""_cow (const char*     s, std::size_t n) { return cow::string::from_static(s, n); }
+  inline cow::u16string operator""_cow (const char16_t* s, std::size_t n) { return cow::u16string::from_static(s, n); }
+  inline cow::u32string operator""_cow (const char32_t* s, std::size_t n) { return cow::u32string::from_static(s, n); }
+  inline cow::wstring   operator""_cow (const wchar_t*  s, std::size_t n) { return cow::wstring::from_static(s, n); }
+} // namespace cow::literals
+
+
+//------------------------------------------------------------------------------
+// Exchanges the values of two strings : cow::swap(..)
+//------------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+void swap (cow::basic_string<charT,traits,Alloc>& x,
+           cow::basic_string<charT,traits,Alloc>& y) noexcept
+{
+  x.swap(y);
+}
+
+
+//------------------------------------------------------------------------------
+// Trivial relocation : cow::is_trivially_relocatable
+//------------------------------------------------------------------------------
+// A type is trivially relocatable if move-constructing an object somewhere
+// else and destroying the original is equivalent to copying its bytes.
+// cow::basic_string handles qualify: they never point into themselves.
+// Specialize this to opt other types in.
+template < class T >
+struct is_trivially_relocatable : std::is_trivially_copyable<T> {};
+
+template < class charT, class traits, class Alloc >
+struct is_trivially_relocatable< cow::basic_string<charT,traits,Alloc> > : std::true_type {};
+
+template < class T >
+T* _uninitialized_relocate (T* first, T* last, T* dest, std::true_type) noexcept
+{
+  const std::size_t n = last - first;
+  if( n != 0 ) {
+    std::memcpy( static_cast<void*>(dest), static_cast<const void*>(first), n * sizeof(T) );
+  }
+  return dest + n;
+}
+
+template < class T >
+T* _uninitialized_relocate (T* first, T* last, T* dest, std::false_type) noexcept
+{
+  for( ; first != last; ++first, ++dest ) {
+    ::new (static_cast<void*>(dest)) T( std::move(*first) );
+    first->~T();
+  }
+  return dest;
+}
+
+// Relocate [first, last) to the uninitialized storage at 'dest', which must
+// not overlap. Ends the lifetime of the source objects. Trivially relocatable
+// types are memcpy'd, others are moved (which must not throw) and destroyed.
+template < class T >
+T* uninitialized_relocate (T* first, T* last, T* dest) noexcept
+{
+  static_assert( cow::is_trivially_relocatable<T>::value ||
+                 std::is_nothrow_move_constructible<T>::value,
+                 "cow::uninitialized_relocate requires a noexcept move constructor" );
+  return cow::_uninitialized_relocate( first, last, dest,
+    std::integral_constant<bool, cow::is_trivially_relocatable<T>::value>() );
+}
+#endif
+
+
+//------------------------------------------------------------------------------
+// Read a line from a stream : cow::getline(..)
+//------------------------------------------------------------------------------
+// Same as std::getline. A writeable string reads the line in place, so a
+// loop reading lines into one string reuses its capacity; a read-only one
+// (such as a new, empty string) reads it into a std::basic_string that it
+// then keeps as its writeable one, without a copy (see operator>> too).
+template < class charT, class t, class A >
+std::basic_istream<charT,t>& getline (std::basic_istream<charT,t>& is, cow::basic_string<charT,t,A>& str, charT delim);
+template < class charT, class t, class A >
+std::basic_istream<charT,t>& getline (std::basic_istream<charT,t>& is, cow::basic_string<charT,t,A>& str);
+
+
+// The concatenation of [lhs, lhs+lhsize) and [rhs, rhs+rhsize), made in a
+// single allocation. The characters are copied by std::char_traits (memcpy of
+// size * sizeof(charT) bytes).
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> _concat(const charT* lhs, std::size_t lhsize,
+                                              const charT* rhs, std::size_t rhsize) {
+  std::basic_string<charT,traits,Alloc> result;
+  result.reserve(lhsize + rhsize);
+  result.append(lhs, lhsize);
+  result.append(rhs, rhsize);
+  return cow::basic_string<charT,traits,Alloc>(std::move(result));
+}
+
+// Same, reusing 'lhs' (or 'rhs') if it is writeable and has room: chains like
+// a + b + c then append to the first temporary.
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> _concat(cow::basic_string<charT,traits,Alloc>&& lhs,
+                                              const charT* rhs, std::size_t rhsize) {
+  if( rhsize == 0 ) {
+    return std::move(lhs);
+  }
+  // Shared strings have no room: their capacity is their size.
+  if( lhs.capacity() - lhs.size() >= rhsize ) {
+    lhs.append(rhs, rhsize);
+    return std::move(lhs);
+  }
+  return cow::_concat<charT,traits,Alloc>(lhs.data(), lhs.size(), rhs, rhsize);
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string<charT,traits,Alloc> _concat(const charT* lhs, std::size_t lhsize,
+                                              cow::basic_string<charT,traits,Alloc>&& rhs) {
+  if( lhsize == 0 ) {
+    return std::move(rhs);
+  }
+  if( rhs.capacity() - rhs.size() >= lhsize ) {
+    rhs.insert(0, lhs, lhsize);
+    return std::move(rhs);
+  }
+  return cow::_concat<charT,traits,Alloc>(lhs, lhsize, rhs.data(), rhs.size());
+}
+
+
+} // namespace cow::
+
+
+#if 0
+//------------------------------------------------------------------------------
+// Template specialization : std::hash<cow_string>
+//------------------------------------------------------------------------------
+namespace std {
+  template<> struct hash<cow_string> {
+    std::size_t operator()(const cow_string& s) const
+#if __cplusplus >= 201103L
+      noexcept
+#endif
+    {
+      return s.hash();
+    }
+  };
+}
+#endif
+
+
+//------------------------------------------------------------------------------
+// Concatenate strings : operator+ (cow::basic_string)
+//------------------------------------------------------------------------------
+
+// string (1.1)
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
+                                        const cow::basic_string<charT,t,A>& rhs);
+
+// string (1.2)
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (const std::basic_string<charT,t,A>& lhs,
+                                        const cow::basic_string<charT,t,A>& rhs);
+
+// string (1.3)
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
+                                        const std::basic_string<charT,t,A>& rhs);
+
+// c-string (2)
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
+                                        const charT*                        rhs);
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (const charT*                        lhs,
+                                        const cow::basic_string<charT,t,A>& rhs);
+
+// character (3)
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
+                                        charT                               rhs);
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (charT                               lhs,
+                                        const cow::basic_string<charT,t,A>& rhs);
+
+#if __cplusplus >= 201103L // move semantics
+
+// string (1.1)
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
+                                        cow::basic_string<charT,t,A>&&      rhs);
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
+                                        const cow::basic_string<charT,t,A>& rhs);
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
+                                        cow::basic_string<charT,t,A>&&      rhs);
+
+// string (1.2)
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (std::basic_string<charT,t,A>&&      lhs,
+                                        cow::basic_string<charT,t,A>&&      rhs);
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (std::basic_string<charT,t,A>&&      lhs,
+                                        const cow::basic_string<charT,t,A>& rhs);
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (const std::basic_string<charT,t,A>& lhs,
+                                        cow::basic_string<charT,t,A>&&      rhs);
+
+// string (1.3)
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
+                                        std::basic_string<charT,t,A>&&      rhs);
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
+                                        const std::basic_string<charT,t,A>& rhs);
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (const cow::basic_string<charT,t,A>& lhs,
+                                        std::basic_string<charT,t,A>&&      rhs);
+
+// c-string (2)
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
+                                        const charT*                        rhs);
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (const charT*                        lhs,
+                                        cow::basic_string<charT,t,A>&&      rhs);
+
+// character (3)
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (cow::basic_string<charT,t,A>&&      lhs,
+                                        charT                               rhs);
+template < class charT, class t, class A >
+cow::basic_string<charT,t,A> operator+ (charT                               lhs,
+                                        cow::basic_string<charT,t,A>&&      rhs);
+#endif
+
+
+//------------------------------------------------------------------------------
+// Insert string into stream : operator<< (cow::basic_string)
+//------------------------------------------------------------------------------
+template < class charT, class t, class A >
+std::basic_ostream<charT,t>& operator<< (std::basic_ostream<charT,t>& os, const cow::basic_string<charT,t,A>& str);
+
+
+//------------------------------------------------------------------------------
+// Extract string from stream : operator>> (cow::basic_string)
+//------------------------------------------------------------------------------
+template < class charT, class t, class A >
+std::basic_istream<charT,t>& operator>> (std::basic_istream<charT,t>& is, cow::basic_string<charT,t,A>& str);
+
+
+//------------------------------------------------------------------------------
+// Relational operators : operator==, operator<, .. (cow::basic_string)
+//------------------------------------------------------------------------------
+// Defined with compare(), so that including this header is enough. They are
+// in namespace cow, so that std::less, std::sort and the like find them.
+namespace cow {
+
+template < class charT, class t, class A >
+bool operator== (const cow::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return lhs.size() == rhs.size() && lhs.compare(rhs) == 0; }
+template < class charT, class t, class A >
+bool operator!= (const cow::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return lhs.size() != rhs.size() || lhs.compare(rhs) != 0; }
+template < class charT, class t, class A >
+bool operator<  (const cow::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return lhs.compare(rhs) < 0; }
+template < class charT, class t, class A >
+bool operator<= (const cow::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return lhs.compare(rhs) <= 0; }
+template < class charT, class t, class A >
+bool operator>  (const cow::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return lhs.compare(rhs) > 0; }
+template < class charT, class t, class A >
+bool operator>= (const cow::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return lhs.compare(rhs) >= 0; }
+
+template < class charT, class t, class A >
+bool operator== (const cow::basic_string<charT,t,A>& lhs, const charT*                        rhs) { return lhs.compare(rhs) == 0; }
+template < class charT, class t, class A >
+bool operator!= (const cow::basic_string<charT,t,A>& lhs, const charT*                        rhs) { return lhs.compare(rhs) != 0; }
+template < class charT, class t, class A >
+bool operator<  (const cow::basic_string<charT,t,A>& lhs, const charT*                        rhs) { return lhs.compare(rhs) < 0; }
+template < class charT, class t, class A >
+bool operator<= (const cow::basic_string<charT,t,A>& lhs, const charT*                        rhs) { return lhs.compare(rhs) <= 0; }
+template < class charT, class t, class A >
+bool operator>  (const cow::basic_string<charT,t,A>& lhs, const charT*                        rhs) { return lhs.compare(rhs) > 0; }
+template < class charT, class t, class A >
+bool operator>= (const cow::basic_string<charT,t,A>& lhs, const charT*                        rhs) { return lhs.compare(rhs) >= 0; }
+
+template < class charT, class t, class A >
+bool operator== (const charT*                        lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.compare(lhs) == 0; }
+template < class charT, class t, class A >
+bool operator!= (const charT*                        lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.compare(lhs) != 0; }
+template < class charT, class t, class A >
+bool operator<  (const charT*                        lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.compare(lhs) > 0; }
+template < class charT, class t, class A >
+bool operator<= (const charT*                        lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.compare(lhs) >= 0; }
+template < class charT, class t, class A >
+bool operator>  (const charT*                        lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.compare(lhs) < 0; }
+template < class charT, class t, class A >
+bool operator>= (const charT*                        lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.compare(lhs) <= 0; }
+
+template < class charT, class t, class A >
+bool operator== (const cow::basic_string<charT,t,A>& lhs, const std::basic_string<charT,t,A>& rhs) { return lhs.size() == rhs.size() && lhs.compare(rhs) == 0; }
+template < class charT, class t, class A >
+bool operator!= (const cow::basic_string<charT,t,A>& lhs, const std::basic_string<charT,t,A>& rhs) { return lhs.size() != rhs.size() || lhs.compare(rhs) != 0; }
+template < class charT, class t, class A >
+bool operator<  (const cow::basic_string<charT,t,A>& lhs, const std::basic_string<charT,t,A>& rhs) { return lhs.compare(rhs) < 0; }
+template < class charT, class t, class A >
+bool operator<= (const cow::basic_string<charT,t,A>& lhs, const std::basic_string<charT,t,A>& rhs) { return lhs.compare(rhs) <= 0; }
+template < class charT, class t, class A >
+bool operator>  (const cow::basic_string<charT,t,A>& lhs, const std::basic_string<charT,t,A>& rhs) { return lhs.compare(rhs) > 0; }
+template < class charT, class t, class A >
+bool operator>= (const cow::basic_string<charT,t,A>& lhs, const std::basic_string<charT,t,A>& rhs) { return lhs.compare(rhs) >= 0; }
+
+template < class charT, class t, class A >
+bool operator== (const std::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.size() == lhs.size() && rhs.compare(lhs) == 0; }
+template < class charT, class t, class A >
+bool operator!= (const std::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.size() != lhs.size() || rhs.compare(lhs) != 0; }
+template < class charT, class t, class A >
+bool operator<  (const std::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.compare(lhs) > 0; }
+template < class charT, class t, class A >
+bool operator<= (const std::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.compare(lhs) >= 0; }
+template < class charT, class t, class A >
+bool operator>  (const std::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.compare(lhs) < 0; }
+template < class charT, class t, class A >
+bool operator>= (const std::basic_string<charT,t,A>& lhs, const cow::basic_string<charT,t,A>& rhs) { return rhs.compare(lhs) <= 0; }
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Explicit instantiations : cow_string_impl
+//------------------------------------------------------------------------------
+// The cow_string_impl library (cow_string.cpp) instantiates cow::string,
+// u16string, u32string and wstring and their operators once. Targets linking
+// it get COWSTRING_EXTERN_TEMPLATES defined, so that their translation units
+// don't instantiate them again. Translation units that only use these types
+// may include cow_string_decl.hpp instead of cow_string.hpp, and then don't
+// parse the definitions (nor <istream> and <ostream>) at all. The library and
+// its users must agree on COWSTRING_BIASED_REFCOUNT.
+#if __cplusplus >= 201103L
+# define COWSTRING_INSTANTIATE_MOVE(kind, charT) \
+  kind cow::basic_string<charT> operator+ (cow::basic_string<charT>&&, cow::basic_string<charT>&&);            \
+  kind cow::basic_string<charT> operator+ (cow::basic_string<charT>&&, const cow::basic_string<charT>&);       \
+  kind cow::basic_string<charT> operator+ (const cow::basic_string<charT>&, cow::basic_string<charT>&&);       \
+  kind cow::basic_string<charT> operator+ (std::basic_string<charT>&&, cow::basic_string<charT>&&);            \
+  kind cow::basic_string<charT> operator+ (std::basic_string<charT>&&, const cow::basic_string<charT>&);       \
+  kind cow::basic_string<charT> operator+ (const std::basic_string<charT>&, cow::basic_string<charT>&&);       \
+  kind cow::basic_string<charT> operator+ (cow::basic_string<charT>&&, std::basic_string<charT>&&);            \
+  kind cow::basic_string<charT> operator+ (cow::basic_string<charT>&&, const std::basic_string<charT>&);       \
+  kind cow::basic_string<charT> operator+ (const cow::basic_string<charT>&, std::basic_string<charT>&&);       \
+  kind cow::basic_string<charT> operator+ (cow::basic_string<charT>&&, const charT*);                          \
+  kind cow::basic_string<charT> operator+ (const charT*, cow::basic_string<charT>&&);                          \
+  kind cow::basic_string<charT> operator+ (cow::basic_string<charT>&&, charT);                                 \
+  kind cow::basic_string<charT> operator+ (charT, cow::basic_string<charT>&&);
+#else
+# define COWSTRING_INSTANTIATE_MOVE(kind, charT)
+#endif
+
+#define COWSTRING_INSTANTIATE(kind, charT) \
+  kind class cow::basic_string<charT>;                                                                         \
+  kind cow::basic_string<charT> operator+ (const cow::basic_string<charT>&, const cow::basic_string<charT>&);  \
+  kind cow::basic_string<charT> operator+ (const std::basic_string<charT>&, const cow::basic_string<charT>&);  \
+  kind cow::basic_string<charT> operator+ (const cow::basic_string<charT>&, const std::basic_string<charT>&);  \
+  kind cow::basic_string<charT> operator+ (const cow::basic_string<charT>&, const charT*);                     \
+  kind cow::basic_string<charT> operator+ (const charT*, const cow::basic_string<charT>&);                     \
+  kind cow::basic_string<charT> operator+ (const cow::basic_string<charT>&, charT);                            \
+  kind cow::basic_string<charT> operator+ (charT, const cow::basic_string<charT>&);                            \
+  kind std::basic_ostream<charT>& operator<< (std::basic_ostream<charT>&, const cow::basic_string<charT>&);    \
+  kind std::basic_istream<charT>& operator>> (std::basic_istream<charT>&, cow::basic_string<charT>&);          \
+  kind std::basic_istream<charT>& cow::getline (std::basic_istream<charT>&, cow::basic_string<charT>&, charT); \
+  kind std::basic_istream<charT>& cow::getline (std::basic_istream<charT>&, cow::basic_string<charT>&);        \
+  COWSTRING_INSTANTIATE_MOVE(kind, charT)
+
+#if defined(COWSTRING_EXTERN_TEMPLATES)
+COWSTRING_INSTANTIATE(extern template, char)
+COWSTRING_INSTANTIATE(extern template, char16_t)
+COWSTRING_INSTANTIATE(extern template, char32_t)
+COWSTRING_INSTANTIATE(extern template, wchar_t)
+#endif
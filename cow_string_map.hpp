@@ -0,0 +1,807 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#if __cplusplus >= 201703L
+# include <string_view>
+#endif
+#if defined(__SSE2__)
+# include <emmintrin.h>
+#endif
+
+#include "cow_memory.hpp"
+#include "cow_string.hpp"
+
+namespace cow {
+
+//------------------------------------------------------------------------------
+// Hash set and map of strings : cow::string_set, cow::string_map<T>
+//------------------------------------------------------------------------------
+// Open addressing tables (like Abseil's SwissTable): a control byte per slot
+// holds 7 bits of the hash of its string, or marks it empty or erased. A
+// lookup reads the control bytes of a group of slots at once (16 with SSE2,
+// 8 otherwise) and only compares the strings whose 7 bits match.
+//
+// Lookups (find, count, contains, erase, at) take the key as a
+// cow::basic_string, a std::basic_string, a 'const charT*' or (C++17) a
+// std::basic_string_view, and never make a cow::basic_string of it. So do
+// insert() of the set and try_emplace() and operator[] of the map, which only
+// make one when the key is missing (a cow::basic_string key is shared).
+//
+// Inserting may rehash, which invalidates iterators and references; erasing
+// doesn't. The order of iteration is unspecified.
+//
+// Strings are hashed by their bytes, so only std::char_traits strings are
+// accepted: other traits may compare different bytes as equal.
+template < class String, class Value, class KeyOf, bool Mutable >
+class _string_table;
+
+template < class charT,
+           class traits = std::char_traits<charT>,
+           class Alloc = std::allocator<charT>
+           >
+class basic_string_set;
+
+template < class T,
+           class charT = char,
+           class traits = std::char_traits<charT>,
+           class Alloc = std::allocator<charT>
+           >
+class basic_string_map;
+
+typedef basic_string_set<char>     string_set;
+typedef basic_string_set<wchar_t>  wstring_set;
+typedef basic_string_set<char16_t> u16string_set;
+typedef basic_string_set<char32_t> u32string_set;
+
+template < class T > using string_map    = basic_string_map<T, char>;
+template < class T > using wstring_map   = basic_string_map<T, wchar_t>;
+template < class T > using u16string_map = basic_string_map<T, char16_t>;
+template < class T > using u32string_map = basic_string_map<T, char32_t>;
+
+
+// Control bytes: full slots hold 7 bits of their hash (0 to 127).
+enum : signed char {
+  _ctrl_empty   = -128,
+  _ctrl_deleted = -2
+};
+
+inline unsigned _lowest_bit(std::uint64_t mask) {
+#if defined(__GNUC__)
+  return static_cast<unsigned>(__builtin_ctzll(mask));
+#else
+  unsigned i = 0;
+  for( ; (mask & 1) == 0; mask >>= 1 ) {
+    ++i;
+  }
+  return i;
+#endif
+}
+
+#if defined(__SSE2__)
+// The control bytes of 16 slots. Masks have a bit per slot.
+struct _ctrl_group {
+  static const std::size_t width = 16;
+
+  explicit _ctrl_group(const signed char* ctrl)
+    : m_ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(ctrl))) {}
+
+  std::uint64_t match(signed char h2) const {
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), m_ctrl)));
+  }
+  std::uint64_t match_empty() const {
+    return match(_ctrl_empty);
+  }
+  // Empty or deleted.
+  std::uint64_t match_free() const {
+    return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), m_ctrl)));
+  }
+  static std::size_t index(std::uint64_t mask) { return cow::_lowest_bit(mask); }
+
+  __m128i m_ctrl;
+};
+#else
+// The control bytes of 8 slots, in a 64-bit word (SWAR). Masks have the top
+// bit of each slot's byte. match() may report false positives past a real
+// match, which comparing the strings rules out.
+struct _ctrl_group {
+  static const std::size_t width = 8;
+
+  explicit _ctrl_group(const signed char* ctrl) : m_ctrl(0) {
+    for( std::size_t i = 0; i < width; ++i ) {
+      m_ctrl |= std::uint64_t(static_cast<unsigned char>(ctrl[i])) << (8 * i);
+    }
+  }
+
+  std::uint64_t match(signed char h2) const {
+    const std::uint64_t x = m_ctrl ^ (lsbs * static_cast<unsigned char>(h2));
+    return (x - lsbs) & ~x & msbs;
+  }
+  std::uint64_t match_empty() const {
+    return m_ctrl & ~(m_ctrl << 6) & msbs;  // top bit set, bit 1 clear
+  }
+  std::uint64_t match_free() const {
+    return m_ctrl & ~(m_ctrl << 7) & msbs;  // top bit set, bit 0 clear
+  }
+  static std::size_t index(std::uint64_t mask) { return cow::_lowest_bit(mask) / 8; }
+
+  static const std::uint64_t lsbs = UINT64_C(0x0101010101010101);
+  static const std::uint64_t msbs = UINT64_C(0x8080808080808080);
+  std::uint64_t m_ctrl;
+};
+#endif
+
+template < class KeyOf, class Reference, class Pointer >
+class _string_table_iterator
+{
+public:
+  typedef std::forward_iterator_tag    iterator_category;
+  typedef typename KeyOf::value_type   value_type;
+  typedef std::ptrdiff_t               difference_type;
+  typedef Pointer                      pointer;
+  typedef Reference                    reference;
+  typedef typename KeyOf::slot_type    slot_type;
+
+  _string_table_iterator() : m_ctrl(nullptr), m_end(nullptr), m_slot(nullptr) {}
+  // Points at the first full slot from 'slot' on.
+  _string_table_iterator(const signed char* ctrl, const signed char* end, slot_type* slot)
+    : m_ctrl(ctrl), m_end(end), m_slot(slot) { _skip_free(); }
+  // iterator to const_iterator (not the other way around).
+  template < class R, class P, class = typename std::enable_if<
+               std::is_convertible<P, Pointer>::value>::type >
+  _string_table_iterator(const _string_table_iterator<KeyOf,R,P>& other)
+    : m_ctrl(other.m_ctrl), m_end(other.m_end), m_slot(other.m_slot) {}
+
+  reference                operator*  () const { return KeyOf::value(*m_slot); }
+  pointer                  operator-> () const { return &KeyOf::value(*m_slot); }
+  _string_table_iterator&  operator++ () { ++m_ctrl; ++m_slot; _skip_free(); return *this; }
+  _string_table_iterator   operator++ (int) { _string_table_iterator copy(*this); ++*this; return copy; }
+
+  template < class R, class P >
+  bool operator== (const _string_table_iterator<KeyOf,R,P>& rhs) const { return m_slot == rhs.m_slot; }
+  template < class R, class P >
+  bool operator!= (const _string_table_iterator<KeyOf,R,P>& rhs) const { return m_slot != rhs.m_slot; }
+
+  void _skip_free() {
+    while( m_ctrl != m_end && *m_ctrl < 0 ) {
+      ++m_ctrl;
+      ++m_slot;
+    }
+  }
+
+  const signed char* m_ctrl;
+  const signed char* m_end;
+  slot_type*         m_slot;
+};
+
+
+//----------------------------------------------------------------------------
+// Template declaration : Open addressing table of strings
+//----------------------------------------------------------------------------
+// What cow::basic_string_set and cow::basic_string_map share: everything but
+// inserting. Values live in 'KeyOf::slot_type' slots, made by constructing a
+// 'KeyOf::mutable_value_type' at 'KeyOf::storage(slot)'. 'KeyOf::value(slot)'
+// is the value of a slot and 'KeyOf::key(slot)' its string;
+// 'KeyOf::relocate(to, from)' moves a value to a new slot when rehashing, and
+// 'KeyOf::destroy(slot)' destroys it.
+template < class String, class Value, class KeyOf, bool Mutable >
+class _string_table
+{
+  static_assert( std::is_same< typename String::traits_type,
+                               std::char_traits<typename String::value_type> >::value,
+                 "cow::basic_string_set and basic_string_map hash bytes: traits must be std::char_traits" );
+
+public:
+  typedef String                                  key_type;
+  typedef Value                                   value_type;
+  typedef std::size_t                             size_type;
+  typedef typename String::value_type             char_type;
+  typedef typename String::traits_type            traits_type;
+  typedef typename std::conditional<Mutable, Value&, const Value&>::type reference;
+  typedef const Value&                            const_reference;
+  typedef _string_table_iterator< KeyOf, reference,
+    typename std::conditional<Mutable, Value*, const Value*>::type > iterator;
+  typedef _string_table_iterator<KeyOf, const Value&, const Value*> const_iterator;
+
+  _string_table();
+  _string_table(const _string_table& other);
+  _string_table(_string_table&& other) noexcept;
+  ~_string_table();
+  _string_table& operator= (const _string_table& other);
+  _string_table& operator= (_string_table&& other) noexcept;
+
+  iterator       begin()       { return iterator(m_ctrl, m_ctrl + m_capacity, m_slots); }
+  const_iterator begin() const { return const_iterator(m_ctrl, m_ctrl + m_capacity, m_slots); }
+  iterator       end()         { return iterator(m_ctrl + m_capacity, m_ctrl + m_capacity, m_slots + m_capacity); }
+  const_iterator end()   const { return const_iterator(m_ctrl + m_capacity, m_ctrl + m_capacity, m_slots + m_capacity); }
+
+  bool        empty()        const { return m_size == 0; }
+  std::size_t size()         const { return m_size; }
+  std::size_t bucket_count() const { return m_capacity; }
+  double      load_factor()  const { return m_capacity == 0 ? 0.0 : double(m_size) / double(m_capacity); }
+
+  void clear();
+  // Room for 'n' strings without rehashing.
+  void reserve(std::size_t n);
+
+  template < class K > iterator       find(const K& key);
+  template < class K > const_iterator find(const K& key) const;
+  template < class K > std::size_t    count(const K& key) const;
+  template < class K > bool           contains(const K& key) const;
+
+  // (Iterators go to the other overload.)
+  template < class K, class = typename std::enable_if<
+               !std::is_convertible<const K&, const_iterator>::value>::type >
+  std::size_t                         erase(const K& key);
+  iterator                            erase(const_iterator pos);
+
+  void swap(_string_table& other) noexcept;
+
+protected:
+  typedef typename String::value_type  charT;
+  typedef typename String::traits_type traits;
+  typedef typename KeyOf::slot_type    slot_type;
+
+  // The characters of a key.
+  static const charT* _chars(const charT* s, std::size_t& n) { n = traits::length(s); return s; }
+  template < class A >
+  static const charT* _chars(const std::basic_string<charT,traits,A>& s, std::size_t& n) { n = s.size(); return s.data(); }
+  template < class A >
+  static const charT* _chars(const cow::basic_string<charT,traits,A>& s, std::size_t& n) { n = s.size(); return s.data(); }
+#if __cplusplus >= 201703L
+  static const charT* _chars(std::basic_string_view<charT,traits> s, std::size_t& n) { n = s.size(); return s.data(); }
+#endif
+
+  // The string to insert for a missing key: a cow::basic_string is shared.
+  static String _make_key(const String& key) { return key; }
+  template < class K >
+  static String _make_key(const K& key) { std::size_t n; const charT* s = _chars(key, n); return String(s, n); }
+
+  static std::uint64_t _hash(const charT* s, std::size_t n) { return cow::_hash_chars(s, n); }
+
+  iterator _iterator_at(std::size_t i) { return iterator(m_ctrl + i, m_ctrl + m_capacity, m_slots + i); }
+
+  // Index of the string [s, s+n) (whose hash is 'hash'), or m_capacity.
+  std::size_t _find(const charT* s, std::size_t n, std::uint64_t hash) const;
+
+  // Finds [s, s+n), or calls 'make(storage)' to construct the
+  // KeyOf::mutable_value_type of a new slot. Returns the index of the slot,
+  // and whether it was made.
+  template < class Make >
+  std::pair<std::size_t, bool> _emplace(const charT* s, std::size_t n, Make make);
+
+private:
+  // Room for a string of hash 'hash', which isn't in the table.
+  std::size_t _free_slot(std::uint64_t hash) const;
+  void        _set_ctrl(std::size_t i, signed char c);
+  void        _rehash(std::size_t capacity);
+  void        _destroy();
+
+  static std::size_t _growth(std::size_t capacity) { return capacity - capacity / 8; }
+
+  signed char* m_ctrl;         // m_capacity bytes, then the first group's again
+  slot_type*   m_slots;
+  std::size_t  m_capacity;     // 0, or a power of 2 (and at least a group)
+  std::size_t  m_size;
+  std::size_t  m_growth_left;  // empty slots that may still be filled
+
+}; // template class _string_table
+
+template < class String >
+struct _set_key {
+  typedef String value_type;
+  typedef String mutable_value_type;
+  typedef String slot_type;
+  static void*         storage(slot_type* slot) { return slot; }
+  static String&       value(slot_type& slot) { return slot; }
+  static const String& key(const slot_type& slot) { return slot; }
+  static void relocate(slot_type* to, slot_type* from) { new (to) String(std::move(*from)); }
+  static void destroy(slot_type* slot) { slot->~String(); }
+};
+
+// Like SwissTable's map slots: the pair is made, moved and destroyed with a
+// mutable key, so rehashing moves keys rather than copying them (which would
+// share a writeable string's characters), and handed out with a const one.
+template < class String, class T >
+struct _map_key {
+  typedef std::pair<const String, T> value_type;
+  typedef std::pair<String, T>       mutable_value_type;
+  union slot_type {
+    slot_type() {}
+    ~slot_type() {}
+    value_type         value;
+    mutable_value_type mutable_value;
+  };
+  static void*         storage(slot_type* slot) { return &slot->mutable_value; }
+  static value_type&   value(slot_type& slot) { return slot.value; }
+  static const String& key(const slot_type& slot) { return slot.value.first; }
+  static void relocate(slot_type* to, slot_type* from) {
+    new (&to->mutable_value) mutable_value_type(std::move(from->mutable_value));
+  }
+  static void destroy(slot_type* slot) { slot->mutable_value.~mutable_value_type(); }
+};
+
+
+//----------------------------------------------------------------------------
+// Template declaration : Hash set of strings
+//----------------------------------------------------------------------------
+template < class charT, class traits, class Alloc >
+class basic_string_set
+  : public _string_table< cow::basic_string<charT,traits,Alloc>,
+                          cow::basic_string<charT,traits,Alloc>,
+                          cow::_set_key< cow::basic_string<charT,traits,Alloc> >, false >
+{
+  typedef _string_table< cow::basic_string<charT,traits,Alloc>,
+                         cow::basic_string<charT,traits,Alloc>,
+                         cow::_set_key< cow::basic_string<charT,traits,Alloc> >, false > _table;
+public:
+  typedef typename _table::iterator       iterator;
+  typedef typename _table::const_iterator const_iterator;
+
+  basic_string_set() {}
+  basic_string_set(std::initializer_list< cow::basic_string<charT,traits,Alloc> > il);
+  template < class InputIterator >
+  basic_string_set(InputIterator first, InputIterator last);
+
+  // Any key type find() takes.
+  template < class K >
+  std::pair<iterator, bool> insert(const K& key);
+  std::pair<iterator, bool> insert(cow::basic_string<charT,traits,Alloc>&& key);
+  template < class InputIterator >
+  void                      insert(InputIterator first, InputIterator last);
+
+}; // template class basic_string_set
+
+
+//----------------------------------------------------------------------------
+// Template declaration : Hash map of strings
+//----------------------------------------------------------------------------
+template < class T, class charT, class traits, class Alloc >
+class basic_string_map
+  : public _string_table< cow::basic_string<charT,traits,Alloc>,
+                          std::pair<const cow::basic_string<charT,traits,Alloc>, T>,
+                          cow::_map_key< cow::basic_string<charT,traits,Alloc>, T >, true >
+{
+  typedef _string_table< cow::basic_string<charT,traits,Alloc>,
+                         std::pair<const cow::basic_string<charT,traits,Alloc>, T>,
+                         cow::_map_key< cow::basic_string<charT,traits,Alloc>, T >, true > _table;
+  typedef std::pair<cow::basic_string<charT,traits,Alloc>, T> _mutable_value;
+public:
+  typedef T                                mapped_type;
+  typedef typename _table::value_type      value_type;
+  typedef typename _table::iterator        iterator;
+  typedef typename _table::const_iterator  const_iterator;
+
+  basic_string_map() {}
+  basic_string_map(std::initializer_list<value_type> il);
+
+  std::pair<iterator, bool> insert(const value_type& value);
+  std::pair<iterator, bool> insert(value_type&& value);
+  // Constructs the value from 'args' if 'key' (any key type find() takes) is
+  // missing, and does nothing otherwise.
+  template < class K, class... Args >
+  std::pair<iterator, bool> try_emplace(const K& key, Args&&... args);
+
+  // Inserts a value-initialized T if 'key' is missing.
+  template < class K > T&       operator[] (const K& key);
+  // Throws std::out_of_range if 'key' is missing.
+  template < class K > T&       at(const K& key);
+  template < class K > const T& at(const K& key) const;
+
+}; // template class basic_string_map
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Implementation
+//------------------------------------------------------------------------------
+template < class String, class Value, class KeyOf, bool Mutable >
+cow::_string_table<String,Value,KeyOf,Mutable>::_string_table()
+  : m_ctrl(nullptr)
+  , m_slots(nullptr)
+  , m_capacity(0)
+  , m_size(0)
+  , m_growth_left(0)
+{
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+cow::_string_table<String,Value,KeyOf,Mutable>::_string_table(const _string_table& other)
+  : _string_table()
+{
+  reserve(other.m_size);
+  for( std::size_t i = 0; i < other.m_capacity; ++i ) {
+    if( other.m_ctrl[i] < 0 ) {
+      continue;
+    }
+    const String& key = KeyOf::key(other.m_slots[i]);
+    const Value& value = KeyOf::value(other.m_slots[i]);
+    _emplace(key.data(), key.size(), [&value](void* storage) {
+      new (storage) typename KeyOf::mutable_value_type(value);
+    });
+  }
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+cow::_string_table<String,Value,KeyOf,Mutable>::_string_table(_string_table&& other) noexcept
+  : _string_table()
+{
+  swap(other);
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+cow::_string_table<String,Value,KeyOf,Mutable>::~_string_table()
+{
+  _destroy();
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+cow::_string_table<String,Value,KeyOf,Mutable>&
+cow::_string_table<String,Value,KeyOf,Mutable>::operator= (const _string_table& other)
+{
+  if( this != &other ) {
+    _string_table copy(other);
+    swap(copy);
+  }
+  return *this;
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+cow::_string_table<String,Value,KeyOf,Mutable>&
+cow::_string_table<String,Value,KeyOf,Mutable>::operator= (_string_table&& other) noexcept
+{
+  _string_table moved(std::move(other));
+  swap(moved);
+  return *this;
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+void
+cow::_string_table<String,Value,KeyOf,Mutable>::swap(_string_table& other) noexcept
+{
+  std::swap(m_ctrl,        other.m_ctrl);
+  std::swap(m_slots,       other.m_slots);
+  std::swap(m_capacity,    other.m_capacity);
+  std::swap(m_size,        other.m_size);
+  std::swap(m_growth_left, other.m_growth_left);
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+void
+cow::_string_table<String,Value,KeyOf,Mutable>::clear()
+{
+  for( std::size_t i = 0; i < m_capacity; ++i ) {
+    if( m_ctrl[i] >= 0 ) {
+      KeyOf::destroy(m_slots + i);
+    }
+  }
+  if( m_capacity != 0 ) {
+    std::memset(m_ctrl, _ctrl_empty, m_capacity + cow::_ctrl_group::width);
+  }
+  m_size = 0;
+  m_growth_left = _growth(m_capacity);
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+void
+cow::_string_table<String,Value,KeyOf,Mutable>::reserve(std::size_t n)
+{
+  std::size_t capacity = cow::_ctrl_group::width;
+  while( _growth(capacity) < n ) {
+    capacity *= 2;
+  }
+  if( capacity > m_capacity ) {
+    _rehash(capacity);
+  }
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+template < class K >
+typename cow::_string_table<String,Value,KeyOf,Mutable>::iterator
+cow::_string_table<String,Value,KeyOf,Mutable>::find(const K& key)
+{
+  std::size_t n;
+  const charT* s = _chars(key, n);
+  return _iterator_at(_find(s, n, _hash(s, n)));
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+template < class K >
+typename cow::_string_table<String,Value,KeyOf,Mutable>::const_iterator
+cow::_string_table<String,Value,KeyOf,Mutable>::find(const K& key) const
+{
+  return const_cast<_string_table*>(this)->find(key);
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+template < class K >
+std::size_t
+cow::_string_table<String,Value,KeyOf,Mutable>::count(const K& key) const
+{
+  return contains(key) ? 1 : 0;
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+template < class K >
+bool
+cow::_string_table<String,Value,KeyOf,Mutable>::contains(const K& key) const
+{
+  std::size_t n;
+  const charT* s = _chars(key, n);
+  return _find(s, n, _hash(s, n)) != m_capacity;
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+template < class K, class >
+std::size_t
+cow::_string_table<String,Value,KeyOf,Mutable>::erase(const K& key)
+{
+  const iterator it = find(key);
+  if( it == end() ) {
+    return 0;
+  }
+  erase(it);
+  return 1;
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+typename cow::_string_table<String,Value,KeyOf,Mutable>::iterator
+cow::_string_table<String,Value,KeyOf,Mutable>::erase(const_iterator pos)
+{
+  const std::size_t i = std::size_t(pos.m_slot - m_slots);
+  KeyOf::destroy(m_slots + i);
+  // Lookups probe past full and deleted slots: an empty one would end them.
+  _set_ctrl(i, _ctrl_deleted);
+  --m_size;
+  return _iterator_at(i);
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+std::size_t
+cow::_string_table<String,Value,KeyOf,Mutable>::_find(const charT* s, std::size_t n, std::uint64_t hash) const
+{
+  if( m_capacity == 0 ) {
+    return m_capacity;
+  }
+  const std::size_t mask = m_capacity - 1;
+  const signed char h2 = static_cast<signed char>(hash & 0x7F);
+  std::size_t pos = static_cast<std::size_t>(hash >> 7) & mask;
+  for( std::size_t probe = 1; ; ++probe ) {
+    const cow::_ctrl_group group(m_ctrl + pos);
+    for( std::uint64_t match = group.match(h2); match != 0; match &= match - 1 ) {
+      const std::size_t i = (pos + cow::_ctrl_group::index(match)) & mask;
+      const String& key = KeyOf::key(m_slots[i]);
+      if( key.size() == n && (key.data() == s || traits::compare(key.data(), s, n) == 0) ) {
+        return i;
+      }
+    }
+    if( group.match_empty() != 0 ) {
+      return m_capacity;
+    }
+    pos = (pos + probe * cow::_ctrl_group::width) & mask;  // triangular probing visits every group
+  }
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+std::size_t
+cow::_string_table<String,Value,KeyOf,Mutable>::_free_slot(std::uint64_t hash) const
+{
+  const std::size_t mask = m_capacity - 1;
+  std::size_t pos = static_cast<std::size_t>(hash >> 7) & mask;
+  for( std::size_t probe = 1; ; ++probe ) {
+    const std::uint64_t free = cow::_ctrl_group(m_ctrl + pos).match_free();
+    if( free != 0 ) {
+      return (pos + cow::_ctrl_group::index(free)) & mask;
+    }
+    pos = (pos + probe * cow::_ctrl_group::width) & mask;
+  }
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+template < class Make >
+std::pair<std::size_t, bool>
+cow::_string_table<String,Value,KeyOf,Mutable>::_emplace(const charT* s, std::size_t n, Make make)
+{
+  const std::uint64_t hash = _hash(s, n);
+  std::size_t i = _find(s, n, hash);
+  if( i != m_capacity ) {
+    return std::make_pair(i, false);
+  }
+  if( m_growth_left == 0 ) {
+    // Drop the deleted slots, or grow if over half of the room is used.
+    const std::size_t capacity = m_capacity == 0 ? cow::_ctrl_group::width : m_capacity;
+    _rehash(m_size >= _growth(capacity) / 2 ? capacity * 2 : capacity);
+  }
+  i = _free_slot(hash);
+  make(KeyOf::storage(m_slots + i));
+  if( m_ctrl[i] == _ctrl_empty ) {
+    --m_growth_left;
+  }
+  _set_ctrl(i, static_cast<signed char>(hash & 0x7F));
+  ++m_size;
+  return std::make_pair(i, true);
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+void
+cow::_string_table<String,Value,KeyOf,Mutable>::_set_ctrl(std::size_t i, signed char c)
+{
+  m_ctrl[i] = c;
+  if( i < cow::_ctrl_group::width ) {
+    m_ctrl[m_capacity + i] = c;
+  }
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+void
+cow::_string_table<String,Value,KeyOf,Mutable>::_rehash(std::size_t capacity)
+{
+  _string_table table;
+  table.m_ctrl = new signed char[capacity + cow::_ctrl_group::width];
+  std::memset(table.m_ctrl, _ctrl_empty, capacity + cow::_ctrl_group::width);
+  table.m_slots = static_cast<slot_type*>(::operator new(capacity * sizeof(slot_type)));
+  table.m_capacity = capacity;
+  table.m_growth_left = _growth(capacity) - m_size;
+  for( std::size_t i = 0; i < m_capacity; ++i ) {
+    if( m_ctrl[i] < 0 ) {
+      continue;
+    }
+    const String& key = KeyOf::key(m_slots[i]);
+    const std::size_t j = table._free_slot(_hash(key.data(), key.size()));
+    KeyOf::relocate(table.m_slots + j, m_slots + i);
+    table._set_ctrl(j, m_ctrl[i]);
+    ++table.m_size;
+  }
+  swap(table);
+}
+
+template < class String, class Value, class KeyOf, bool Mutable >
+void
+cow::_string_table<String,Value,KeyOf,Mutable>::_destroy()
+{
+  for( std::size_t i = 0; i < m_capacity; ++i ) {
+    if( m_ctrl[i] >= 0 ) {
+      KeyOf::destroy(m_slots + i);
+    }
+  }
+  delete[] m_ctrl;
+  ::operator delete(static_cast<void*>(m_slots));
+  m_ctrl = nullptr;
+  m_slots = nullptr;
+  m_capacity = m_size = m_growth_left = 0;
+}
+
+template < class charT, class traits, class Alloc >
+cow::basic_string_set<charT,traits,Alloc>::basic_string_set(std::initializer_list< cow::basic_string<charT,traits,Alloc> > il)
+{
+  insert(il.begin(), il.end());
+}
+
+template < class charT, class traits, class Alloc >
+template < class InputIterator >
+cow::basic_string_set<charT,traits,Alloc>::basic_string_set(InputIterator first, InputIterator last)
+{
+  insert(first, last);
+}
+
+template < class charT, class traits, class Alloc >
+template < class K >
+std::pair<typename cow::basic_string_set<charT,traits,Alloc>::iterator, bool>
+cow::basic_string_set<charT,traits,Alloc>::insert(const K& key)
+{
+  typedef cow::basic_string<charT,traits,Alloc> String;
+  std::size_t n;
+  const charT* s = _table::_chars(key, n);
+  const std::pair<std::size_t, bool> result = this->_emplace(s, n, [&key](void* slot) {
+    new (slot) String(_table::_make_key(key));
+  });
+  return std::make_pair(this->_iterator_at(result.first), result.second);
+}
+
+template < class charT, class traits, class Alloc >
+std::pair<typename cow::basic_string_set<charT,traits,Alloc>::iterator, bool>
+cow::basic_string_set<charT,traits,Alloc>::insert(cow::basic_string<charT,traits,Alloc>&& key)
+{
+  typedef cow::basic_string<charT,traits,Alloc> String;
+  const std::pair<std::size_t, bool> result = this->_emplace(key.data(), key.size(), [&key](void* slot) {
+    new (slot) String(std::move(key));
+  });
+  return std::make_pair(this->_iterator_at(result.first), result.second);
+}
+
+template < class charT, class traits, class Alloc >
+template < class InputIterator >
+void
+cow::basic_string_set<charT,traits,Alloc>::insert(InputIterator first, InputIterator last)
+{
+  for( ; first != last; ++first ) {
+    insert(*first);
+  }
+}
+
+template < class T, class charT, class traits, class Alloc >
+cow::basic_string_map<T,charT,traits,Alloc>::basic_string_map(std::initializer_list<value_type> il)
+{
+  this->reserve(il.size());
+  for( const value_type& value : il ) {
+    insert(value);
+  }
+}
+
+template < class T, class charT, class traits, class Alloc >
+std::pair<typename cow::basic_string_map<T,charT,traits,Alloc>::iterator, bool>
+cow::basic_string_map<T,charT,traits,Alloc>::insert(const value_type& value)
+{
+  const std::pair<std::size_t, bool> result = this->_emplace(value.first.data(), value.first.size(), [&value](void* storage) {
+    new (storage) _mutable_value(value);
+  });
+  return std::make_pair(this->_iterator_at(result.first), result.second);
+}
+
+template < class T, class charT, class traits, class Alloc >
+std::pair<typename cow::basic_string_map<T,charT,traits,Alloc>::iterator, bool>
+cow::basic_string_map<T,charT,traits,Alloc>::insert(value_type&& value)
+{
+  const std::pair<std::size_t, bool> result = this->_emplace(value.first.data(), value.first.size(), [&value](void* storage) {
+    new (storage) _mutable_value(std::move(value));
+  });
+  return std::make_pair(this->_iterator_at(result.first), result.second);
+}
+
+template < class T, class charT, class traits, class Alloc >
+template < class K, class... Args >
+std::pair<typename cow::basic_string_map<T,charT,traits,Alloc>::iterator, bool>
+cow::basic_string_map<T,charT,traits,Alloc>::try_emplace(const K& key, Args&&... args)
+{
+  std::size_t n;
+  const charT* s = _table::_chars(key, n);
+  const std::pair<std::size_t, bool> result = this->_emplace(s, n, [&](void* storage) {
+    new (storage) _mutable_value(std::piecewise_construct,
+                                 std::forward_as_tuple(_table::_make_key(key)),
+                                 std::forward_as_tuple(std::forward<Args>(args)...));
+  });
+  return std::make_pair(this->_iterator_at(result.first), result.second);
+}
+
+template < class T, class charT, class traits, class Alloc >
+template < class K >
+T&
+cow::basic_string_map<T,charT,traits,Alloc>::operator[] (const K& key)
+{
+  return try_emplace(key).first->second;
+}
+
+template < class T, class charT, class traits, class Alloc >
+template < class K >
+T&
+cow::basic_string_map<T,charT,traits,Alloc>::at(const K& key)
+{
+  const iterator it = this->find(key);
+  if( it == this->end() ) {
+    throw std::out_of_range("cow::basic_string_map::at");
+  }
+  return it->second;
+}
+
+template < class T, class charT, class traits, class Alloc >
+template < class K >
+const T&
+cow::basic_string_map<T,charT,traits,Alloc>::at(const K& key) const
+{
+  return const_cast<basic_string_map*>(this)->at(key);
+}
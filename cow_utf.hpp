@@ -0,0 +1,316 @@
+/**
+ * Copyright (c) 2023 Oli Legat <http://github.com/olegat>.
+ * Licensed under the BSD 3-Clause License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include "cow_string.hpp"
+
+// Largest conversion cached by cow::to_utf8(..) etc., in bytes of source plus
+// result. Larger ones aren't cached.
+#if !defined(COWSTRING_UTF_CACHE_MAX_BYTES)
+# define COWSTRING_UTF_CACHE_MAX_BYTES 4096
+#endif
+
+namespace cow {
+
+//------------------------------------------------------------------------------
+// Convert between UTF-8, UTF-16 and UTF-32 : cow::to_utf8(..), ..
+//------------------------------------------------------------------------------
+// cow::string holds UTF-8, cow::u16string UTF-16 and cow::u32string UTF-32;
+// cow::wstring holds UTF-16 or UTF-32, depending on sizeof(wchar_t).
+//
+// The input is validated (overlong forms, surrogates and code points above
+// U+10FFFF are rejected) while the size of the result is counted, then the
+// result is written into a single allocation. Runs of ASCII are checked and
+// widened 8 bytes at a time. Throws std::range_error if the input is
+// ill-formed.
+//
+// Conversions of shared (read-only) strings are cached per thread, keyed by
+// the buffer: converting the same buffer again returns a copy of the first
+// result, without allocating. A cached entry keeps its source alive until it
+// is evicted by another buffer or cleared by cow::clear_utf_cache(). Only
+// conversions of up to COWSTRING_UTF_CACHE_MAX_BYTES (source plus result,
+// 4096 by default) are cached, in 64 entries per pair of types: at most 2 MiB
+// per thread by default.
+cow::string    to_utf8 (const cow::u16string& str);
+cow::string    to_utf8 (const cow::u32string& str);
+cow::string    to_utf8 (const cow::wstring& str);
+cow::u16string to_utf16(const cow::string& str);
+cow::u16string to_utf16(const cow::u32string& str);
+cow::u32string to_utf32(const cow::string& str);
+cow::u32string to_utf32(const cow::u16string& str);
+cow::wstring   to_wide (const cow::string& str);
+
+// Drops the calling thread's cached conversions.
+void clear_utf_cache();
+
+
+// Receives the code points of a decoded string, and encodes them as charT
+// (UTF-8, UTF-16 or UTF-32, by the size of charT). Only counts them unless
+// 'write' is true.
+template < class charT, bool write >
+struct _utf_sink {
+  explicit _utf_sink(charT* out = nullptr) : out(out), count(0) {}
+
+  template < class unitT >
+  void ascii(const unitT* s, std::size_t n) {
+    if( write ) {
+      for( std::size_t i = 0; i < n; ++i ) {
+        out[count + i] = static_cast<charT>(s[i]);
+      }
+    }
+    count += n;
+  }
+
+  void put(char32_t c) {
+    if( sizeof(charT) == 1 ) {
+      if( c < 0x80 ) {
+        _unit(c);
+      } else if( c < 0x800 ) {
+        _unit(0xC0 | (c >> 6));
+        _unit(0x80 | (c & 0x3F));
+      } else if( c < 0x10000 ) {
+        _unit(0xE0 | (c >> 12));
+        _unit(0x80 | ((c >> 6) & 0x3F));
+        _unit(0x80 | (c & 0x3F));
+      } else {
+        _unit(0xF0 | (c >> 18));
+        _unit(0x80 | ((c >> 12) & 0x3F));
+        _unit(0x80 | ((c >> 6) & 0x3F));
+        _unit(0x80 | (c & 0x3F));
+      }
+    } else if( sizeof(charT) == 2 && c >= 0x10000 ) {
+      c -= 0x10000;
+      _unit(0xD800 + (c >> 10));
+      _unit(0xDC00 + (c & 0x3FF));
+    } else {
+      _unit(c);
+    }
+  }
+
+  void _unit(char32_t u) {
+    if( write ) {
+      out[count] = static_cast<charT>(u);
+    }
+    ++count;
+  }
+
+  charT*      out;
+  std::size_t count;
+};
+
+// Length of the run of ASCII characters at the start of [s, last), tested a
+// 64-bit word at a time.
+template < class unitT >
+std::size_t _utf_ascii_run(const unitT* s, const unitT* last) {
+  static const std::size_t k = 8 / sizeof(unitT);
+  // Every bit of each unit but its 7 low ones.
+  static const std::uint64_t mask =
+    ~(UINT64_C(0x7F) * (~UINT64_C(0) / (~UINT64_C(0) >> (64 - 8 * sizeof(unitT)))));
+  const unitT* p = s;
+  while( static_cast<std::size_t>(last - p) >= k ) {
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    if( (word & mask) != 0 ) {
+      break;
+    }
+    p += k;
+  }
+  while( p != last && static_cast<std::uint32_t>(*p) < 0x80 ) {
+    ++p;
+  }
+  return static_cast<std::size_t>(p - s);
+}
+
+// Decode UTF-8.
+template < class unitT, class Sink >
+void _utf_decode(const unitT* p, const unitT* last, Sink& sink, std::integral_constant<std::size_t, 1>) {
+  static const char* const error = "cow: ill-formed UTF-8";
+  while( p != last ) {
+    const std::size_t n = cow::_utf_ascii_run(p, last);
+    if( n != 0 ) {
+      sink.ascii(p, n);
+      p += n;
+      continue;
+    }
+    const std::uint32_t c0 = static_cast<unsigned char>(*p);
+    std::size_t len;
+    std::uint32_t lo = 0x80, hi = 0xBF;  // range of the 2nd byte
+    if( c0 < 0xC2 ) {
+      throw std::range_error(error);  // continuation or overlong
+    } else if( c0 < 0xE0 ) {
+      len = 2;
+    } else if( c0 < 0xF0 ) {
+      len = 3;
+      if( c0 == 0xE0 ) lo = 0xA0;       // overlong
+      if( c0 == 0xED ) hi = 0x9F;       // surrogates
+    } else if( c0 < 0xF5 ) {
+      len = 4;
+      if( c0 == 0xF0 ) lo = 0x90;       // overlong
+      if( c0 == 0xF4 ) hi = 0x8F;       // above U+10FFFF
+    } else {
+      throw std::range_error(error);
+    }
+    if( static_cast<std::size_t>(last - p) < len ) {
+      throw std::range_error(error);
+    }
+    std::uint32_t c = c0 & (0x7F >> len);
+    for( std::size_t i = 1; i < len; ++i ) {
+      const std::uint32_t ci = static_cast<unsigned char>(p[i]);
+      if( i == 1 ? (ci < lo || ci > hi) : (ci & 0xC0) != 0x80 ) {
+        throw std::range_error(error);
+      }
+      c = (c << 6) | (ci & 0x3F);
+    }
+    sink.put(c);
+    p += len;
+  }
+}
+
+// Decode UTF-16.
+template < class unitT, class Sink >
+void _utf_decode(const unitT* p, const unitT* last, Sink& sink, std::integral_constant<std::size_t, 2>) {
+  static const char* const error = "cow: ill-formed UTF-16";
+  while( p != last ) {
+    const std::size_t n = cow::_utf_ascii_run(p, last);
+    if( n != 0 ) {
+      sink.ascii(p, n);
+      p += n;
+      continue;
+    }
+    const std::uint32_t c = static_cast<std::uint16_t>(*p);
+    if( c < 0xD800 || c > 0xDFFF ) {
+      sink.put(c);
+      ++p;
+      continue;
+    }
+    if( c > 0xDBFF || last - p < 2 ) {
+      throw std::range_error(error);  // unpaired surrogate
+    }
+    const std::uint32_t c2 = static_cast<std::uint16_t>(p[1]);
+    if( c2 < 0xDC00 || c2 > 0xDFFF ) {
+      throw std::range_error(error);
+    }
+    sink.put(0x10000 + ((c - 0xD800) << 10) + (c2 - 0xDC00));
+    p += 2;
+  }
+}
+
+// Decode UTF-32.
+template < class unitT, class Sink >
+void _utf_decode(const unitT* p, const unitT* last, Sink& sink, std::integral_constant<std::size_t, 4>) {
+  while( p != last ) {
+    const std::size_t n = cow::_utf_ascii_run(p, last);
+    if( n != 0 ) {
+      sink.ascii(p, n);
+      p += n;
+      continue;
+    }
+    const std::uint32_t c = static_cast<std::uint32_t>(*p);
+    if( c > 0x10FFFF || (c >= 0xD800 && c <= 0xDFFF) ) {
+      throw std::range_error("cow: ill-formed UTF-32");
+    }
+    sink.put(c);
+    ++p;
+  }
+}
+
+template < class Dst, class Src >
+Dst _utf_convert(const Src& src) {
+  typedef typename Src::value_type unitT;
+  typedef typename Dst::value_type charT;
+  typedef std::integral_constant<std::size_t, sizeof(unitT)> width;
+  const unitT* first = src.data();
+  const unitT* last  = first + src.size();
+  cow::_utf_sink<charT, false> counter;
+  cow::_utf_decode(first, last, counter, width());
+  std::basic_string<charT> result(counter.count, charT());
+  cow::_utf_sink<charT, true> writer(&result[0]);
+  cow::_utf_decode(first, last, writer, width());
+  return Dst(std::move(result));
+}
+
+struct _utf_cache {
+  static const std::size_t size = 64;
+
+  template < class Dst, class Src >
+  struct entry {
+    Src source;
+    Dst result;
+  };
+
+  template < class Dst, class Src >
+  static entry<Dst,Src>* entries() {
+    static thread_local entry<Dst,Src> cache[size];
+    return cache;
+  }
+
+  template < class Dst, class Src >
+  static Dst convert(const Src& src) {
+    if( src.empty() ) {
+      return Dst();
+    }
+    // A writeable buffer may change, so it's not a key.
+    if( !src._is_readonly() ) {
+      return cow::_utf_convert<Dst>(src);
+    }
+    const std::uintptr_t key = reinterpret_cast<std::uintptr_t>(src.data());
+    entry<Dst,Src>& e = entries<Dst,Src>()[((key >> 4) ^ (key >> 10)) % size];
+    if( e.source.data() == src.data() && e.source.size() == src.size() ) {
+      return e.result;
+    }
+    Dst result = cow::_utf_convert<Dst>(src);
+    if( src.size() * sizeof(typename Src::value_type) +
+        result.size() * sizeof(typename Dst::value_type) <= COWSTRING_UTF_CACHE_MAX_BYTES ) {
+      e.source = src;
+      e.result = result;
+    }
+    return result;
+  }
+
+  template < class Dst, class Src >
+  static void clear() {
+    entry<Dst,Src>* cache = entries<Dst,Src>();
+    for( std::size_t i = 0; i < size; ++i ) {
+      cache[i] = entry<Dst,Src>();
+    }
+  }
+};
+
+
+} // namespace cow::
+
+
+//------------------------------------------------------------------------------
+// Implementation
+//------------------------------------------------------------------------------
+inline cow::string    cow::to_utf8 (const cow::u16string& str) { return cow::_utf_cache::convert<cow::string>(str); }
+inline cow::string    cow::to_utf8 (const cow::u32string& str) { return cow::_utf_cache::convert<cow::string>(str); }
+inline cow::string    cow::to_utf8 (const cow::wstring& str)   { return cow::_utf_cache::convert<cow::string>(str); }
+inline cow::u16string cow::to_utf16(const cow::string& str)    { return cow::_utf_cache::convert<cow::u16string>(str); }
+inline cow::u16string cow::to_utf16(const cow::u32string& str) { return cow::_utf_cache::convert<cow::u16string>(str); }
+inline cow::u32string cow::to_utf32(const cow::string& str)    { return cow::_utf_cache::convert<cow::u32string>(str); }
+inline cow::u32string cow::to_utf32(const cow::u16string& str) { return cow::_utf_cache::convert<cow::u32string>(str); }
+inline cow::wstring   cow::to_wide (const cow::string& str)    { return cow::_utf_cache::convert<cow::wstring>(str); }
+
+inline void
+cow::clear_utf_cache()
+{
+  cow::_utf_cache::clear<cow::string, cow::u16string>();
+  cow::_utf_cache::clear<cow::string, cow::u32string>();
+  cow::_utf_cache::clear<cow::string, cow::wstring>();
+  cow::_utf_cache::clear<cow::u16string, cow::string>();
+  cow::_utf_cache::clear<cow::u16string, cow::u32string>();
+  cow::_utf_cache::clear<cow::u32string, cow::string>();
+  cow::_utf_cache::clear<cow::u32string, cow::u16string>();
+  cow::_utf_cache::clear<cow::wstring, cow::string>();
+}
@@ -11,6 +11,7 @@
 #include <vector>
 
 #include <cassert>
+#include <cstring>
 
 using ifstream  = std::ifstream;
 using ofstream  = std::ofstream;
@@ -8,6 +8,7 @@
 #include "term.hpp"
 #include <iostream>
 #include <sstream>
+#include <cstring>
 
 using sstream = std::stringstream;
 
@@ -8,6 +8,10 @@ using process_internal = struct process_posix;
 #include "process.hpp"
 
 #include <unistd.h>
+#include <strings.h>
+#include <sys/wait.h>
+#include <cassert>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 